@@ -39,11 +39,13 @@
   When using the multiplexing configurations, an assumption is made
   that there are three multiplexing channels, corresponding to red,
   green, and blue in that order, and that the gamma correction lookup
-  table is included so that colors may be displayed properly.
+  table and HSV functions are included so that colors may be displayed
+  properly.
 
   Additional Makefile configuration for "-multiplexing" schematics:
   TLC5940_MULTIPLEX_N = 3
   TLC5940_INCLUDE_GAMMA_CORRECT = 1
+  TLC5940_INCLUDE_HSV = 1
 
   How dot correction works:
 
@@ -88,6 +90,13 @@
 // ------ The non-multiplexing (single-color) example is presented first ------
 #if (TLC5940_ENABLE_MULTIPLEXING == 0)
 
+#if (TLC5940_ENABLE_RENDER)
+#include "tlc5940-render.h"
+
+// The channel that TLC5940_Render() lights up
+volatile channel_t renderChannel;
+#endif // TLC5940_ENABLE_RENDER
+
 int main(void) {
   // Initialize the TLC5940 library
   TLC5940_Init();
@@ -99,8 +108,10 @@ int main(void) {
   TLC5940_ClockInDC();
 #endif // TLC5940_INCLUDE_DC_FUNCS
 
+#if (TLC5940_ENABLE_RENDER == 0)
   // Set the initial grayscale value for every channel to 0
   TLC5940_SetAllGS(0);
+#endif // TLC5940_ENABLE_RENDER
   // Always clock in the initial grayscale values before enabling interrupts
   TLC5940_ClockInGS();
 
@@ -115,11 +126,16 @@ int main(void) {
       // Wait until we are allowed to update the grayscale values
       while(TLC5940_GetGSUpdateFlag());
 
+#if (TLC5940_ENABLE_RENDER)
+      // Have the render callback light up only the current channel
+      renderChannel = i;
+#else // TLC5940_ENABLE_RENDER
       // Set the PWM duty cycle for all channels to 0%
       TLC5940_SetAllGS(0);
 
       // Set the PWM duty cycle for the current channel to 100%
       TLC5940_SetGS(i, 4095);
+#endif // TLC5940_ENABLE_RENDER
 
       // Signal the library to start using the new grayscale values
       TLC5940_SetGSUpdateFlag();
@@ -134,11 +150,16 @@ int main(void) {
       // Wait until we are allowed to update the grayscale values
       while(TLC5940_GetGSUpdateFlag());
 
+#if (TLC5940_ENABLE_RENDER)
+      // Have the render callback light up only the current channel
+      renderChannel = i;
+#else // TLC5940_ENABLE_RENDER
       // Set the PWM duty cycle for all channels to 0%
       TLC5940_SetAllGS(0);
 
       // Set the PWM duty cycle for the current channel to 100%
       TLC5940_SetGS(i, 4095);
+#endif // TLC5940_ENABLE_RENDER
 
       // Signal the library to start using the new grayscale values
       TLC5940_SetGSUpdateFlag();
@@ -163,35 +184,9 @@ int main(void) {
 #error "This demo requires TLC5940_INCLUDE_GAMMA_CORRECT = 1 set in tlc5940.mk"
 #endif // TLC5940_INCLUDE_GAMMA_CORRECT
 
-/*
-  Accepts a color_index (ranging between 0 and 767, inclusive) into
-  the spectrum of colors. Upon returning, the arguments r, g, and b
-  will be set to the red, green, and blue components of that part of
-  the spectrum.
-*/
-static inline void SetColorToIndex(uint16_t color_index, uint8_t *r, uint8_t *g, uint8_t *b) __attribute__ (( always_inline ));
-static inline void SetColorToIndex(uint16_t color_index, uint8_t *r, uint8_t *g, uint8_t *b) {
-  uint8_t group = color_index >> 8;
-  uint8_t value = (uint8_t)color_index;
-
-  switch (group) {
-  case 0:
-    *r = 255 - value;
-    *g = value;
-    *b = 0;
-    break;
-  case 1:
-    *r = 0;
-    *g = 255 - value;
-    *b = value;
-    break;
-  case 2:
-    *r = value;
-    *g = 0;
-    *b = 255 - value;
-    break;
-  }
-}
+#if (TLC5940_INCLUDE_HSV != 1)
+#error "This demo requires TLC5940_INCLUDE_HSV = 1 set in tlc5940.mk"
+#endif // TLC5940_INCLUDE_HSV
 
 int main(void) {
   // Initialize the TLC5940 library
@@ -213,8 +208,8 @@ int main(void) {
   // Enable global interrupts
   sei();
 
-  // Stores the index of the current color we are drawing with
-  uint16_t color_index = 0;
+  // Stores the hue of the current color we are drawing with
+  uint16_t hue = 0;
 
   // Infinite loop
   for (;;) {
@@ -228,20 +223,18 @@ int main(void) {
       for (uint8_t row = 0; row < TLC5940_MULTIPLEX_N; ++row)
         TLC5940_SetAllGS(row, 0);
 
-      // Retrieve the RGB components of our current place in the spectrum
-      uint8_t r = 0;
-      uint8_t g = 0;
-      uint8_t b = 0;
-      SetColorToIndex(color_index, &r, &g, &b);
+      // Retrieve the gamma-corrected RGB components of our current hue
+      uint16_t r, g, b;
+      TLC5940_HSVtoGS(hue, 255, 255, &r, &g, &b);
 
-      // Increment our place in the spectrum by 1, accounting for rollover
-      if (++color_index >= 768)
-        color_index = 0;
+      // Advance our place in the spectrum (1024 steps around the wheel),
+      // which rolls over on its own back to exactly where it started
+      hue += 64;
 
-      // Set the RGB color (using gamma-correction) for the current channel
-      TLC5940_SetGS(0, i, TLC5940_GammaCorrect(r));
-      TLC5940_SetGS(1, i, TLC5940_GammaCorrect(g));
-      TLC5940_SetGS(2, i, TLC5940_GammaCorrect(b));
+      // Set the RGB color for the current channel
+      TLC5940_SetGS(0, i, r);
+      TLC5940_SetGS(1, i, g);
+      TLC5940_SetGS(2, i, b);
 
       // Signal the library to start using the new grayscale values
       TLC5940_SetGSUpdateFlag();
@@ -260,20 +253,18 @@ int main(void) {
       for (uint8_t row = 0; row < TLC5940_MULTIPLEX_N; ++row)
         TLC5940_SetAllGS(row, 0);
 
-      // Retrieve the RGB components of our current place in the spectrum
-      uint8_t r = 0;
-      uint8_t g = 0;
-      uint8_t b = 0;
-      SetColorToIndex(color_index, &r, &g, &b);
+      // Retrieve the gamma-corrected RGB components of our current hue
+      uint16_t r, g, b;
+      TLC5940_HSVtoGS(hue, 255, 255, &r, &g, &b);
 
-      // Increment our place in the spectrum by 1, accounting for rollover
-      if (++color_index >= 768)
-        color_index = 0;
+      // Advance our place in the spectrum (1024 steps around the wheel),
+      // which rolls over on its own back to exactly where it started
+      hue += 64;
 
-      // Set the RGB color (using gamma-correction) for the current channel
-      TLC5940_SetGS(0, i, TLC5940_GammaCorrect(r));
-      TLC5940_SetGS(1, i, TLC5940_GammaCorrect(g));
-      TLC5940_SetGS(2, i, TLC5940_GammaCorrect(b));
+      // Set the RGB color for the current channel
+      TLC5940_SetGS(0, i, r);
+      TLC5940_SetGS(1, i, g);
+      TLC5940_SetGS(2, i, b);
 
       // Signal the library to start using the new grayscale values
       TLC5940_SetGSUpdateFlag();
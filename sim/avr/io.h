@@ -0,0 +1,212 @@
+/*
+
+  sim/avr/io.h
+
+  Copyright 2015 Matthew T. Pandina. All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY MATTHEW T. PANDINA "AS IS" AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHEW T. PANDINA OR
+  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+  USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+  SUCH DAMAGE.
+
+  --------------------------------------------------------------------
+
+  The ATmega328P registers and bits used by the library, for the host
+  model in sim.c. See sim.h for how they behave.
+
+*/
+
+#ifndef SIM_AVR_IO_H
+#define SIM_AVR_IO_H
+
+#include "../sim.h"
+
+// Ports
+#define PINB (*Sim_PinRegister(SIM_PORTB))
+#define DDRB sim_io[0x24]
+#define PORTB (*Sim_PortRegister(SIM_PORTB))
+#define PINC (*Sim_PinRegister(SIM_PORTC))
+#define DDRC sim_io[0x27]
+#define PORTC (*Sim_PortRegister(SIM_PORTC))
+#define PIND (*Sim_PinRegister(SIM_PORTD))
+#define DDRD sim_io[0x2A]
+#define PORTD (*Sim_PortRegister(SIM_PORTD))
+
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PB6 6
+#define PB7 7
+#define PC0 0
+#define PC1 1
+#define PC2 2
+#define PC3 3
+#define PC4 4
+#define PC5 5
+#define PC6 6
+#define PD0 0
+#define PD1 1
+#define PD2 2
+#define PD3 3
+#define PD4 4
+#define PD5 5
+#define PD6 6
+#define PD7 7
+
+// General purpose I/O registers, and the status register
+#define GPIOR0 sim_io[0x3E]
+#define GPIOR1 sim_io[0x4A]
+#define GPIOR2 sim_io[0x4B]
+#define SREG sim_io[0x5F]
+
+// External interrupts
+#define EIFR sim_io[0x3C]
+#define EIMSK sim_io[0x3D]
+#define EICRA sim_io[0x69]
+#define INTF0 0
+#define INT0 0
+#define ISC00 0
+#define ISC01 1
+
+// Timer/Counter0
+#define TIFR0 sim_io[0x35]
+#define TCCR0A sim_io[0x44]
+#define TCCR0B sim_io[0x45]
+#define TCNT0 sim_io[0x46]
+#define OCR0A sim_io[0x47]
+#define OCR0B sim_io[0x48]
+#define TIMSK0 sim_io[0x6E]
+#define WGM00 0
+#define WGM01 1
+#define COM0B0 4
+#define COM0B1 5
+#define CS00 0
+#define CS01 1
+#define CS02 2
+#define WGM02 3
+#define OCIE0A 1
+#define OCF0A 1
+
+// Timer/Counter1
+#define TIFR1 sim_io[0x36]
+#define TIMSK1 sim_io[0x6F]
+#define TCCR1A sim_io[0x80]
+#define TCCR1B sim_io[0x81]
+#define TCCR1C sim_io[0x82]
+#define TCNT1 sim_tcnt1
+#define ICR1 sim_icr1
+#define OCR1A sim_ocr1a
+#define WGM10 0
+#define WGM11 1
+#define COM1A0 6
+#define COM1A1 7
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define WGM12 3
+#define WGM13 4
+#define ICES1 6
+#define ICNC1 7
+#define ICIE1 5
+#define ICF1 5
+
+// Timer/Counter2
+#define TIFR2 sim_io[0x37]
+#define TIMSK2 sim_io[0x70]
+#define TCCR2A sim_io[0xB0]
+#define TCCR2B sim_io[0xB1]
+#define TCNT2 sim_io[0xB2]
+#define OCR2A sim_io[0xB3]
+#define OCR2B sim_io[0xB4]
+#define WGM20 0
+#define WGM21 1
+#define COM2B0 4
+#define COM2B1 5
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define WGM22 3
+#define OCIE2A 1
+#define OCF2A 1
+
+// SPI
+#define SPCR sim_io[0x4C]
+#define SPSR sim_io[0x4D]
+#define SPDR (*Sim_DataRegister())
+#define SPR0 0
+#define SPR1 1
+#define MSTR 4
+#define SPE 6
+#define SPI2X 0
+#define SPIF 7
+
+// USART0
+#define UCSR0A sim_io[0xC0]
+#define UCSR0B sim_io[0xC1]
+#define UCSR0C sim_io[0xC2]
+#define UBRR0 sim_ubrr0
+#define UDR0 (*Sim_DataRegister())
+#define UDRE0 5
+#define TXC0 6
+#define RXC0 7
+#define TXEN0 3
+#define RXEN0 4
+#define UMSEL00 6
+#define UMSEL01 7
+
+// TWI
+#define TWBR sim_io[0xB8]
+#define TWSR sim_io[0xB9]
+#define TWAR sim_io[0xBA]
+#define TWDR sim_io[0xBB]
+#define TWCR sim_io[0xBC]
+#define TWAMR sim_io[0xBD]
+#define TWGCE 0
+#define TWIE 0
+#define TWEN 2
+#define TWSTO 4
+#define TWSTA 5
+#define TWEA 6
+#define TWINT 7
+
+// ADC
+#define ADCH sim_io[0x79]
+#define ADCSRA sim_io[0x7A]
+#define ADCSRB sim_io[0x7B]
+#define ADMUX sim_io[0x7C]
+#define DIDR0 sim_io[0x7E]
+#define ADPS0 0
+#define ADPS1 1
+#define ADPS2 2
+#define ADIE 3
+#define ADIF 4
+#define ADATE 5
+#define ADSC 6
+#define ADEN 7
+#define ADLAR 5
+#define REFS0 6
+#define REFS1 7
+
+#endif // SIM_AVR_IO_H
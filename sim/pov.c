@@ -0,0 +1,225 @@
+/*
+
+  sim/pov.c
+
+  Copyright 2015 Matthew T. Pandina. All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY MATTHEW T. PANDINA "AS IS" AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHEW T. PANDINA OR
+  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+  USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+  SUCH DAMAGE.
+
+  --------------------------------------------------------------------
+
+  Drives the POV column scheduler with synthetic index pulses, from a
+  display whose speed follows a fixed profile: steady, then swinging
+  between 9 and 11 revolutions per second, then speeding up, and then
+  stopping. Time advances one count of Timer0 and Timer1 (clk_io/64) at
+  a time. Each index pulse is captured into ICR1 on the count it
+  arrives, and the capture interrupt runs up to 30 counts later, at
+  times while the CTC interrupt is also pending.
+
+  The main loop queues every column the scheduler asks for, and each
+  one is checked at the moment it is latched, against the angle the
+  display has actually reached. For each part of the profile this
+  reports how far off the columns were, in ticks, and how many columns
+  were skipped. The errors must stay below the limits below, and once
+  the pulses stop the scheduler must stop within two revolutions.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include <util/delay_basic.h>
+#include "tlc5940.h"
+#include "sim.h"
+
+#define COUNT_SECONDS (64.0 / F_CPU)
+// Counts per tick, as tlc5940.c works out TLC5940_CTC_TOP (Timer1 is
+// taken, so TLC5940_GSCLK_DIVIDER is always 1)
+#if (TLC5940_PWM_BITS == 0)
+#define TICK_COUNTS (TLC5940_CTC_TOP + 1)
+#else // TLC5940_PWM_BITS
+#define TICK_COUNTS ((1 << TLC5940_PWM_BITS) / 64)
+#endif // TLC5940_PWM_BITS
+
+// Worst error allowed while the speed is steady, in ticks. The rounding
+// in TLC5940_POV_QueueColumn() accounts for half a tick, and waiting for
+// row 0 when multiplexing for the rest.
+#if (TLC5940_ENABLE_MULTIPLEXING)
+#define STEADY_LIMIT (0.5 + (TLC5940_MULTIPLEX_N - 1) + 0.1)
+#else // TLC5940_ENABLE_MULTIPLEXING
+#define STEADY_LIMIT (0.5 + 0.1)
+#endif // TLC5940_ENABLE_MULTIPLEXING
+
+// While the speed changes, the fit through the last TLC5940_POV_HISTORY
+// periods lags for a few revolutions after the change starts, by up to
+// 14 ticks with the profile below (at 10 rps, one column is 6 ticks)
+#define CHANGING_LIMIT 16.0
+
+typedef struct {
+  const char *name;
+  double start; // seconds
+  bool steady;
+  double maxErr, sumErr;
+  long columns, skips;
+} Part_t;
+
+static Part_t parts[] = {
+  { "spin up", 0, false, 0, 0, 0, 0 },
+  { "10 rps", 1, true, 0, 0, 0, 0 },
+  { "9-11 rps", 4, false, 0, 0, 0, 0 },
+  { "10-15 rps", 10, false, 0, 0, 0, 0 },
+  { "15 rps", 16, true, 0, 0, 0, 0 },
+  { "stopped", 18, false, 0, 0, 0, 0 },
+};
+#define PARTS (sizeof(parts) / sizeof(parts[0]))
+#define STOP_SECONDS 18.0
+#define END_SECONDS 19.0
+
+// Revolutions per second at 's' seconds
+static double Speed(double s) {
+  if (s < 4)
+    return 10;
+  if (s < 10)
+    return 10 + sin(2 * M_PI * (s - 4) / 3);
+  if (s < 15)
+    return 10 + 5 * (s - 10) / 5;
+  if (s < STOP_SECONDS)
+    return 15;
+  return 0;
+}
+
+static Part_t *Part(double s) {
+  Part_t *part = &parts[0];
+  for (uint8_t i = 0; i < PARTS; i++)
+    if (s >= parts[i].start)
+      part = &parts[i];
+  return part;
+}
+
+int main(void) {
+  TLC5940_Init();
+  TLC5940_ClockInGS();
+  srand(1);
+
+  int failures = 0;
+  long end = (long)(END_SECONDS / COUNT_SECONDS);
+  double angle = 0; // revolutions, at the start of each count
+  long capture = -1; // count at which the capture interrupt runs
+  uint8_t shown = TLC5940_frameShown;
+  long latchAt = -1; // count at which the frame just shifted out is latched
+  int latched = -1, lastColumn = -1;
+  double stoppedAt = -1;
+
+  for (long t = 0; t < end; t++) {
+    double s = t * COUNT_SECONDS;
+    double next = angle + Speed(s) * COUNT_SECONDS;
+    if (floor(next) != floor(angle) && capture < 0) {
+      ICR1 = (uint16_t)t;
+      capture = t + rand() % 30;
+    }
+    angle = next;
+
+    TCNT0 = t % TICK_COUNTS;
+    TCNT1 = (uint16_t)t;
+    bool tick = (TCNT0 == 0 && t > 0);
+    if (capture == t && tick && (rand() & 1)) {
+      // The capture interrupt goes first, with the CTC interrupt pending
+      TIFR0 = (1 << OCF0A);
+      TIMER1_CAPT_vect();
+      TIFR0 = 0;
+      capture = -1;
+    }
+
+    if (t == latchAt) {
+      // The column is on the LEDs from now on
+      Part_t *part = Part(s);
+      double err = angle - floor(angle) - (double)latched / TLC5940_POV_COLUMNS;
+      err -= floor(err + 0.5);
+      err *= 1 / (Speed(s) * COUNT_SECONDS * TICK_COUNTS);
+      if (s > parts[1].start && s < STOP_SECONDS) {
+        if (fabs(err) > part->maxErr)
+          part->maxErr = fabs(err);
+        part->sumErr += fabs(err);
+        part->columns++;
+        if (lastColumn >= 0 && latched != (lastColumn + 1) % TLC5940_POV_COLUMNS)
+          part->skips++;
+      } else if (s >= STOP_SECONDS) {
+        part->columns++;
+      }
+      lastColumn = latched;
+      latchAt = -1;
+    }
+
+    if (tick) {
+      TLC5940_TIMER_COMPA_vect();
+      if (TLC5940_frameShown != shown) {
+        shown = TLC5940_frameShown;
+        latched = TLC5940_frames[shown].buf[0] - 1;
+        latchAt = t + TICK_COUNTS;
+      }
+    }
+    if (capture == t) {
+      TIMER1_CAPT_vect();
+      capture = -1;
+    }
+
+    if (TLC5940_POV_GetSpinning()) {
+      if (!TLC5940_GetFrameQueueFull()) {
+        pBack[0] = TLC5940_POV_NextColumn() + 1;
+        TLC5940_POV_QueueColumn();
+      }
+    } else if (s >= STOP_SECONDS && stoppedAt < 0) {
+      stoppedAt = s;
+    }
+  }
+
+  for (uint8_t i = 1; i < PARTS - 1; i++) {
+    Part_t *part = &parts[i];
+    double limit = part->steady ? STEADY_LIMIT : CHANGING_LIMIT;
+    printf("pov: %-9s %5ld columns, mean error %.2f ticks, max %.2f, %ld skipped\n",
+           part->name, part->columns, part->sumErr / part->columns, part->maxErr, part->skips);
+    if (part->maxErr > limit) {
+      printf("pov: %s: error over %.2f ticks\n", part->name, limit);
+      failures++;
+    }
+    if (part->steady && part->skips) {
+      printf("pov: %s: columns skipped at a steady speed\n", part->name);
+      failures++;
+    }
+  }
+
+  // Two revolutions at 15 rps, plus the columns that were already queued
+  double stopLimit = 2 / Speed(STOP_SECONDS - 1);
+  printf("pov: stopped after %.3f s, %ld columns shown since\n",
+         stoppedAt - STOP_SECONDS, parts[PARTS - 1].columns);
+  if (stoppedAt < 0 || stoppedAt - STOP_SECONDS > stopLimit + 0.01) {
+    printf("pov: not stopped within two revolutions\n");
+    failures++;
+  }
+
+  printf("pov: %d failures\n", failures);
+  return failures != 0;
+}
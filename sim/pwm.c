@@ -0,0 +1,128 @@
+/*
+
+  sim/pwm.c
+
+  Copyright 2015 Matthew T. Pandina. All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY MATTHEW T. PANDINA "AS IS" AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHEW T. PANDINA OR
+  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+  USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+  SUCH DAMAGE.
+
+  --------------------------------------------------------------------
+
+  Switches the PWM resolution through 12, 10, 12, 9, 11 and 12 bits
+  (twice), drawing every frame at full scale for the resolution it is
+  drawn at, and follows what the TLC5940s latch on every interrupt.
+  Whatever is latched must be full scale for the interrupt interval
+  that follows, which is exactly what goes wrong if the interval is
+  switched one interrupt too early or too late (the outputs either
+  never turn off, or turn off early for one period). Each change of
+  either one is printed as it happens.
+
+  XLAT is watched on its pin, which the .mk file puts on PORTC.
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <util/delay_basic.h>
+#include "tlc5940.h"
+#include "sim.h"
+
+#define TICKS 120
+
+static const uint8_t sequence[] = { 12, 10, 12, 9, 11, 12 };
+
+// Largest grayscale value in the data shifted out for one row or frame
+static uint16_t Max(const uint8_t *p) {
+  uint16_t max = 0;
+  for (uint16_t i = 0; i < TLC5940_GRAYSCALE_BYTES; i += 3) {
+    for (uint8_t odd = 0; odd < 2; odd++) {
+      uint16_t value = TLC5940_GetPackedGS(p + i, odd);
+      if (value > max)
+        max = value;
+    }
+  }
+  return max;
+}
+
+static void Draw(uint16_t value) {
+#if (TLC5940_ENABLE_MULTIPLEXING)
+  for (uint8_t row = 0; row < TLC5940_MULTIPLEX_N; row++)
+    TLC5940_SetAllGS(row, value);
+#else // TLC5940_ENABLE_MULTIPLEXING
+  TLC5940_SetAllGS(value);
+#endif // TLC5940_ENABLE_MULTIPLEXING
+}
+
+int main(void) {
+  TLC5940_Init();
+  TLC5940_ClockInGS();
+  Sim_PortHigh(SIM_PORTC);
+  const uint8_t *data;
+  Sim_Shifted(&data);
+
+  uint8_t shifted[TLC5940_GRAYSCALE_BYTES];
+  bool haveShifted = false;
+  uint16_t latched = 0, lastLatched = 0, lastPeriod = 0;
+  int failures = 0, switches = 0;
+  uint8_t next = 0;
+
+  for (int tick = 0; tick < TICKS; tick++) {
+    if (tick % 10 == 5 && !TLC5940_GetGSUpdateFlag()) {
+      Draw((1 << TLC5940_GetPWMBits()) - 1);
+      TLC5940_SetPWMBits(sequence[next++ % sizeof(sequence)]);
+      TLC5940_SetGSUpdateFlag();
+      switches++;
+    }
+
+    TLC5940_TIMER_COMPA_vect();
+
+    if ((Sim_PortHigh(SIM_PORTC) & (1 << XLAT_PIN)) && haveShifted)
+      latched = Max(shifted);
+    size_t n = Sim_Shifted(&data);
+    if (n) {
+      if (n != TLC5940_GRAYSCALE_BYTES) {
+        printf("pwm: tick %d: %u bytes shifted out\n", tick, (unsigned)n);
+        failures++;
+      }
+      memcpy(shifted, data, TLC5940_GRAYSCALE_BYTES);
+      haveShifted = true;
+    }
+
+    // Trace every change of what is latched, or of the period after it
+    uint16_t period = (OCR0A + 1) * 64;
+    bool glitch = (latched != 0 && latched != period - 1);
+    if (latched != lastLatched || period != lastPeriod || glitch) {
+      printf("pwm: tick %3d: %4u latched, period %4u%s\n", tick, latched, period, glitch ? ", glitch" : "");
+      lastLatched = latched;
+      lastPeriod = period;
+    }
+    if (glitch)
+      failures++;
+  }
+
+  printf("pwm: %d ticks, %d switches, %d failures\n", TICKS, switches, failures);
+  return failures != 0;
+}
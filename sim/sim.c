@@ -0,0 +1,130 @@
+/*
+
+  sim/sim.c
+
+  Copyright 2015 Matthew T. Pandina. All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY MATTHEW T. PANDINA "AS IS" AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHEW T. PANDINA OR
+  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+  USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+  SUCH DAMAGE.
+
+  --------------------------------------------------------------------
+
+  Host model of the ATmega328P registers (see sim.h).
+
+*/
+
+#include <string.h>
+#include <avr/io.h>
+#include "sim.h"
+
+// The status flags that the library waits on are always set
+#define SIM_SPSR_READY (1 << SPIF)
+#define SIM_UCSR0A_READY ((1 << UDRE0) | (1 << TXC0))
+
+volatile uint8_t sim_io[0x100] = {
+  [0x4D] = SIM_SPSR_READY,
+  [0xC0] = SIM_UCSR0A_READY,
+};
+volatile uint16_t sim_icr1, sim_ocr1a, sim_tcnt1, sim_ubrr0;
+
+uint8_t sim_eeprom[1024] = {
+  [0 ... 1023] = 0xFF,
+};
+
+static uint8_t portLevel[3];
+static uint8_t portHigh[3];
+
+// The PORTx or PINx access in progress. An access is applied when the
+// next one starts, or a simulation looks at the pins, which is enough as
+// long as no expression touches two of these registers at once.
+static enum { NONE, PORT, PIN } pendingKind;
+static uint8_t pendingPort;
+static volatile uint8_t pendingValue;
+
+static uint8_t shifted[SIM_SHIFTED_N];
+static size_t shiftedN;
+
+static void ApplyPending(void) {
+  if (pendingKind == PORT)
+    portLevel[pendingPort] = pendingValue;
+  else if (pendingKind == PIN)
+    portLevel[pendingPort] ^= pendingValue;
+  if (pendingKind != NONE)
+    portHigh[pendingPort] |= portLevel[pendingPort];
+  pendingKind = NONE;
+}
+
+void Sim_Reset(void) {
+  for (size_t i = 0; i < sizeof(sim_io); i++)
+    sim_io[i] = 0;
+  SPSR = SIM_SPSR_READY;
+  UCSR0A = SIM_UCSR0A_READY;
+  sim_icr1 = sim_ocr1a = sim_tcnt1 = sim_ubrr0 = 0;
+  pendingKind = NONE;
+  memset(portLevel, 0, sizeof(portLevel));
+  memset(portHigh, 0, sizeof(portHigh));
+  shiftedN = 0;
+}
+
+uint8_t Sim_Port(uint8_t port) {
+  ApplyPending();
+  return portLevel[port];
+}
+
+uint8_t Sim_PortHigh(uint8_t port) {
+  ApplyPending();
+  uint8_t high = portHigh[port];
+  portHigh[port] = portLevel[port];
+  return high;
+}
+
+size_t Sim_Shifted(const uint8_t **data) {
+  size_t n = shiftedN;
+  *data = shifted;
+  shiftedN = 0;
+  return n;
+}
+
+volatile uint8_t *Sim_PortRegister(uint8_t port) {
+  ApplyPending();
+  pendingKind = PORT;
+  pendingPort = port;
+  pendingValue = portLevel[port];
+  return &pendingValue;
+}
+
+volatile uint8_t *Sim_PinRegister(uint8_t port) {
+  ApplyPending();
+  pendingKind = PIN;
+  pendingPort = port;
+  pendingValue = 0;
+  return &pendingValue;
+}
+
+volatile uint8_t *Sim_DataRegister(void) {
+  if (shiftedN == SIM_SHIFTED_N)
+    shiftedN--;
+  shifted[shiftedN] = 0;
+  return &shifted[shiftedN++];
+}
@@ -0,0 +1,104 @@
+/*
+
+  sim/sim.h
+
+  Copyright 2015 Matthew T. Pandina. All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY MATTHEW T. PANDINA "AS IS" AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHEW T. PANDINA OR
+  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+  USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+  SUCH DAMAGE.
+
+  --------------------------------------------------------------------
+
+  Host model of the ATmega328P, just detailed enough to run the library
+  on a PC. Every register is a byte in memory, which a simulation sets
+  up and inspects between calls into the library, and each ISR is a
+  plain function that the simulation calls whenever it decides the
+  interrupt fires. Nothing runs by itself: timers don't count, and flags
+  don't set themselves, apart from the SPI and USART status flags the
+  library polls, which always read as ready.
+
+  Three kinds of register get special treatment, since the library
+  writes them more than once per interrupt:
+    PORTx  every write is applied, and the pins that were high at any
+           moment are remembered until Sim_PortHigh() is called
+    PINx   writing a 1 toggles that bit of PORTx, as on the real chip
+           (reading one returns 0)
+    SPDR and UDR0
+           every access is taken as a byte shifted out to the TLC5940s,
+           and collected until Sim_Shifted() is called
+
+  Only TLC5940_SPI_MODE = 0 and 1 are modeled. Each simulation is built
+  by "make sim" together with tlc5940.c and sim.c, using the settings
+  from the .mk file, and the overrides given for it in the Makefile.
+
+*/
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SIM_PORTB 0
+#define SIM_PORTC 1
+#define SIM_PORTD 2
+
+// The memory behind every 8-bit register, indexed by data address, and
+// behind the 16-bit registers the library uses
+extern volatile uint8_t sim_io[0x100];
+extern volatile uint16_t sim_icr1, sim_ocr1a, sim_tcnt1, sim_ubrr0;
+
+// The EEPROM, all 0xFF until a simulation writes to it
+extern uint8_t sim_eeprom[1024];
+
+// Clears every register, and the logs below
+void Sim_Reset(void);
+
+// Level of the output pins of 'port' (SIM_PORTB, C or D)
+uint8_t Sim_Port(uint8_t port);
+
+// Pins of 'port' that were high at any moment since the last call, which
+// catches a pulse that started and ended inside one interrupt
+uint8_t Sim_PortHigh(uint8_t port);
+
+// Every byte shifted out since the last call, oldest first. At most
+// SIM_SHIFTED_N bytes are kept.
+#define SIM_SHIFTED_N 4096
+size_t Sim_Shifted(const uint8_t **data);
+
+// Used by avr/io.h for the registers above
+volatile uint8_t *Sim_PortRegister(uint8_t port);
+volatile uint8_t *Sim_PinRegister(uint8_t port);
+volatile uint8_t *Sim_DataRegister(void);
+
+// The interrupt handlers the library may define, depending on its
+// settings (see avr/interrupt.h)
+void TIMER0_COMPA_vect(void);
+void TIMER2_COMPA_vect(void);
+void TIMER1_CAPT_vect(void);
+void TWI_vect(void);
+void ADC_vect(void);
+void INT0_vect(void);
+
+#endif // SIM_H
@@ -0,0 +1,146 @@
+/*
+
+  sim/sync-board.c
+
+  Copyright 2015 Matthew T. Pandina. All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY MATTHEW T. PANDINA "AS IS" AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHEW T. PANDINA OR
+  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+  USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+  SUCH DAMAGE.
+
+  --------------------------------------------------------------------
+
+  One board of sim/sync.c. This is built into a shared library together
+  with tlc5940.c and sim.c, once for each board, so that every board
+  has its own copy of the library and of the registers. sim/sync.c
+  loads each one, and only calls the functions below.
+
+*/
+
+#include <stdbool.h>
+#include <avr/io.h>
+#include <util/delay_basic.h>
+#include "tlc5940.h"
+#include "sim.h"
+
+// Clock cycles per byte shifted out, as estimated in tlc5940.c
+#if (TLC5940_SPI_MODE == 0)
+#define BOARD_CYCLES_PER_BYTE 25
+#else // TLC5940_SPI_MODE
+#define BOARD_CYCLES_PER_BYTE 19
+#endif // TLC5940_SPI_MODE
+#define BOARD_OVERHEAD_CYCLES 90
+
+// 0 = no sync, 1 = page flips only, 2 = page flips and timer phase
+uint8_t Board_Sync(void) {
+#if (TLC5940_ENABLE_SYNC && TLC5940_SYNC_LEADER)
+  return 1;
+#elif (TLC5940_ENABLE_SYNC)
+  return 1 + TLC5940_SYNC_PHASE;
+#else // TLC5940_ENABLE_SYNC
+  return 0;
+#endif // TLC5940_ENABLE_SYNC
+}
+
+bool Board_Leader(void) {
+#if (TLC5940_ENABLE_SYNC)
+  return TLC5940_SYNC_LEADER;
+#else // TLC5940_ENABLE_SYNC
+  return false;
+#endif // TLC5940_ENABLE_SYNC
+}
+
+// Counts of the CTC timer per interrupt, as worked out in tlc5940.c
+uint8_t Board_Counts(void) {
+#if (TLC5940_PWM_BITS == 0)
+  return TLC5940_CTC_TOP + 1;
+#else // TLC5940_PWM_BITS
+  return (1L << TLC5940_PWM_BITS) * TLC5940_GSCLK_DIVIDER / 64;
+#endif // TLC5940_PWM_BITS
+}
+
+void Board_Init(void) {
+  TLC5940_Init();
+  TLC5940_ClockInGS();
+  Sim_PortHigh(SIM_PORTD);
+}
+
+void Board_SetGSUpdateFlag(void) {
+  TLC5940_SetGSUpdateFlag();
+}
+
+bool Board_GetGSUpdateFlag(void) {
+  return TLC5940_GetGSUpdateFlag();
+}
+
+uint8_t Board_Row(void) {
+#if (TLC5940_ENABLE_MULTIPLEXING)
+  return TLC5940_row;
+#else // TLC5940_ENABLE_MULTIPLEXING
+  return 0;
+#endif // TLC5940_ENABLE_MULTIPLEXING
+}
+
+// Level of the row outputs
+uint8_t Board_Lit(void) {
+#if (TLC5940_ENABLE_MULTIPLEXING)
+  return MULTIPLEX_PORT;
+#else // TLC5940_ENABLE_MULTIPLEXING
+  return 0;
+#endif // TLC5940_ENABLE_MULTIPLEXING
+}
+
+// How many clock cycles the CTC interrupt takes on the chip, when it
+// shifts out a full row or frame
+uint16_t Board_CtcCycles(void) {
+  return BOARD_OVERHEAD_CYCLES + 24 * TLC5940_N * BOARD_CYCLES_PER_BYTE;
+}
+
+// Runs the CTC interrupt, with INTF0 set if the sync edge arrived while
+// it was running
+void Board_Ctc(bool edge) {
+  EIFR = edge ? (1 << INTF0) : 0;
+  TLC5940_TIMER_COMPA_vect();
+  EIFR = 0;
+}
+
+// Whether the sync line (PD2 on PORTD) was raised by the last interrupt
+bool Board_Pulsed(void) {
+#if (TLC5940_ENABLE_SYNC && TLC5940_SYNC_LEADER)
+  return Sim_PortHigh(SIM_PORTD) & (1 << SYNC_PIN);
+#else // TLC5940_ENABLE_SYNC
+  return false;
+#endif // TLC5940_ENABLE_SYNC
+}
+
+// Runs the INT0 interrupt, with the CTC timer at 'count' and its compare
+// match pending or not. Returns the count it leaves the timer at.
+uint8_t Board_Int0(uint8_t count, bool pending) {
+  TCNT0 = count;
+  TIFR0 = pending ? (1 << OCF0A) : 0;
+#if (TLC5940_ENABLE_SYNC && TLC5940_SYNC_LEADER == 0)
+  INT0_vect();
+#endif // TLC5940_ENABLE_SYNC
+  TIFR0 = 0;
+  return TCNT0;
+}
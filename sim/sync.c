@@ -0,0 +1,362 @@
+/*
+
+  sim/sync.c
+
+  Copyright 2015 Matthew T. Pandina. All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY MATTHEW T. PANDINA "AS IS" AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHEW T. PANDINA OR
+  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+  USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+  SUCH DAMAGE.
+
+  --------------------------------------------------------------------
+
+  Four boards sharing a sync line, each running its own copy of the
+  library (built by sim/sync-board.c into sim/sync-0.so through
+  sim/sync-3.so, where board 0 is the leader). Every board has its own
+  crystal, off from the leader's by up to CLOCK_PPM, starts at a random
+  time, and has its prescaler at a random phase. Time is kept in the
+  leader's clock cycles, and each board's interrupts run for as long as
+  they would on the chip, with INT0 taking priority over the CTC
+  interrupt, so the sync edge can be held off by a CTC interrupt.
+
+  All four boards commit a new frame at the same moment, FRAMES times,
+  and the time each one flips to it is compared. The leader's sync edge
+  reaches the followers EDGE_CYCLES after its compare match, and each
+  follower gets to its timer INT0_CYCLES after that, which together are
+  the TLC5940_SYNC_LATENCY counts that tlc5940.c allows for. The spread
+  of the compare matches is also recorded at every commit, and after
+  each CTC interrupt, each follower must light the same row outputs as
+  the leader did for that row.
+
+  With TLC5940_SYNC_PHASE = 1, every frame must flip on every board,
+  with the flips and the compare matches within SKEW_COUNTS counts of
+  each other. With TLC5940_SYNC_PHASE = 0, the flips must be within one
+  interrupt (one BLANK period) of each other. Without sync, the result
+  is only printed, for comparison.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <dlfcn.h>
+
+#define BOARDS 4
+#define FRAMES 600
+#define FRAME_RATE 60
+#define CLOCK_PPM 50.0
+
+// Leader's compare match to its sync edge: the interrupt response and
+// the ISR prologue, up to raising the line
+#define EDGE_CYCLES 40.0
+// Follower's sync edge to the TCNT0 access in its INT0 handler: the
+// interrupt response and the handler's prologue
+#define INT0_CYCLES 30.0
+// How long the INT0 handler runs
+#define INT0_DURATION 70.0
+
+// Worst spread allowed with TLC5940_SYNC_PHASE = 1
+#define SKEW_COUNTS 3
+
+typedef struct {
+  void *handle;
+  uint8_t (*sync)(void);
+  uint8_t (*counts)(void);
+  void (*init)(void);
+  void (*setGSUpdateFlag)(void);
+  bool (*getGSUpdateFlag)(void);
+  uint8_t (*row)(void);
+  uint8_t (*lit)(void);
+  uint16_t (*ctcCycles)(void);
+  void (*ctc)(bool edge);
+  bool (*pulsed)(void);
+  uint8_t (*int0)(uint8_t count, bool pending);
+
+  double scale; // length of one of its clock cycles
+  double grid; // time of one of its prescaler ticks
+  double zero; // time its timer last counted from 0
+  double match; // time of its next compare match
+  double busy; // time its running interrupt ends
+  bool ocf, intf; // pending interrupts
+  double edge; // time the sync edge arrives, or -1
+  double body; // time the CTC interrupt in progress ends, or -1
+  double bodyStart; // and the time it started
+  int frame; // frame waiting in the back buffer, or -1
+  double flip[FRAMES];
+  bool flipped[FRAMES];
+} Board_t;
+
+static Board_t boards[BOARDS];
+static double period; // leader's clock cycles per interrupt
+static uint8_t counts;
+static int litErrors;
+static uint8_t leaderLit[8];
+static bool leaderRowSeen[8];
+
+static void *Symbol(Board_t *b, const char *name) {
+  void *p = dlsym(b->handle, name);
+  if (!p) {
+    printf("sync: %s\n", dlerror());
+    exit(1);
+  }
+  return p;
+}
+
+static void Load(int i) {
+  char path[32];
+  snprintf(path, sizeof(path), "sim/sync-%d.so", i);
+  Board_t *b = &boards[i];
+  b->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if (!b->handle) {
+    printf("sync: %s\n", dlerror());
+    exit(1);
+  }
+  b->sync = Symbol(b, "Board_Sync");
+  b->counts = Symbol(b, "Board_Counts");
+  b->init = Symbol(b, "Board_Init");
+  b->setGSUpdateFlag = Symbol(b, "Board_SetGSUpdateFlag");
+  b->getGSUpdateFlag = Symbol(b, "Board_GetGSUpdateFlag");
+  b->row = Symbol(b, "Board_Row");
+  b->lit = Symbol(b, "Board_Lit");
+  b->ctcCycles = Symbol(b, "Board_CtcCycles");
+  b->ctc = Symbol(b, "Board_Ctc");
+  b->pulsed = Symbol(b, "Board_Pulsed");
+  b->int0 = Symbol(b, "Board_Int0");
+}
+
+static double Prescale(Board_t *b) {
+  return 64 * b->scale;
+}
+
+// Time of the first prescaler tick at or after 't'
+static double TickAfter(Board_t *b, double t) {
+  return b->grid + ceil((t - b->grid) / Prescale(b)) * Prescale(b);
+}
+
+static uint8_t CountAt(Board_t *b, double t) {
+  return (uint8_t)floor((t - b->zero) / Prescale(b) + 1e-9);
+}
+
+// Runs the CTC interrupt that started at 'start'. The leader's is run
+// as it starts, since it raises the sync line early on, and the
+// followers' as they end, so that INTF0 shows an edge that came during it.
+static void Ctc(int i, double start) {
+  Board_t *b = &boards[i];
+  bool flagged = b->getGSUpdateFlag();
+  b->ctc(b->intf);
+  if (flagged && !b->getGSUpdateFlag() && b->frame >= 0) {
+    b->flip[b->frame] = start;
+    b->flipped[b->frame] = true;
+    b->frame = -1;
+  }
+
+  uint8_t row = b->row();
+  if (i == 0) {
+    leaderLit[row] = b->lit();
+    leaderRowSeen[row] = true;
+    if (b->pulsed())
+      for (int j = 1; j < BOARDS; j++)
+        boards[j].edge = start + EDGE_CYCLES;
+  } else if (leaderRowSeen[row] && b->lit() != leaderLit[row]) {
+    if (litErrors++ < 5)
+      printf("sync: board %d lit %02x for row %d, the leader %02x\n", i, b->lit(), row, leaderLit[row]);
+  }
+}
+
+// Distance between the next compare matches of board 'i' and the leader
+static double MatchSkew(int i) {
+  double d = fmod(boards[i].match - boards[0].match, period);
+  if (d < 0)
+    d += period;
+  return (d > period / 2) ? period - d : d;
+}
+
+int main(void) {
+  for (int i = 0; i < BOARDS; i++)
+    Load(i);
+  uint8_t sync = boards[1].sync();
+  counts = boards[0].counts();
+  period = counts * 64.0;
+  srand(1);
+
+  for (int i = 0; i < BOARDS; i++) {
+    Board_t *b = &boards[i];
+    b->scale = 1 + (i ? (rand() % 2001 - 1000) * CLOCK_PPM * 1e-9 : 0);
+    b->init();
+    b->grid = rand() % 64;
+    b->zero = TickAfter(b, rand() % 40000);
+    b->match = b->zero + period * b->scale;
+    b->busy = 0;
+    b->edge = b->body = -1;
+    b->frame = -1;
+  }
+
+  double framePeriod = (double)F_CPU / FRAME_RATE;
+  double nextFrame = 50 * period;
+  double end = nextFrame + framePeriod * (FRAMES + 2);
+  int frame = 0;
+  double maxMatchSkew = 0;
+
+  for (double t = 0; t < end; ) {
+    // Find the next event
+    enum { COMMIT, MATCH, EDGE, BODY, DISPATCH } kind = COMMIT;
+    int who = -1;
+    t = nextFrame;
+    for (int i = 0; i < BOARDS; i++) {
+      Board_t *b = &boards[i];
+      if (b->match < t) {
+        t = b->match;
+        who = i;
+        kind = MATCH;
+      }
+      if (b->edge >= 0 && b->edge < t) {
+        t = b->edge;
+        who = i;
+        kind = EDGE;
+      }
+      if (b->body >= 0 && b->body < t) {
+        t = b->body;
+        who = i;
+        kind = BODY;
+      }
+      if (b->body < 0 && (b->ocf || b->intf) && b->busy < t) {
+        t = b->busy;
+        who = i;
+        kind = DISPATCH;
+      }
+    }
+
+    if (kind == COMMIT) {
+      if (frame < FRAMES) {
+        for (int i = 0; i < BOARDS; i++) {
+          Board_t *b = &boards[i];
+          if (!b->getGSUpdateFlag()) {
+            b->frame = frame;
+            b->setGSUpdateFlag();
+          }
+        }
+        if (frame >= 5)
+          for (int i = 1; i < BOARDS; i++)
+            if (MatchSkew(i) > maxMatchSkew)
+              maxMatchSkew = MatchSkew(i);
+      }
+      frame++;
+      nextFrame += framePeriod;
+      continue;
+    }
+
+    Board_t *b = &boards[who];
+    switch (kind) {
+    case MATCH:
+      b->ocf = true;
+      b->zero = t;
+      b->match = t + period * b->scale;
+      if (b->busy < t)
+        b->busy = t;
+      break;
+    case EDGE:
+      b->edge = -1;
+      if (sync) {
+        b->intf = true;
+        if (b->busy < t)
+          b->busy = t;
+      }
+      break;
+    case BODY:
+      b->body = -1;
+      Ctc(who, b->bodyStart);
+      break;
+    default:
+      if (b->intf) {
+        // INT0 goes first
+        b->intf = false;
+        double access = t + INT0_CYCLES * b->scale;
+        uint8_t count = CountAt(b, access);
+        uint8_t restart = b->int0(count, b->ocf);
+        if (restart != count) {
+          // The timer holds the count written until the next prescaler
+          // tick, and an already pending compare match stays pending
+          double tick = TickAfter(b, access);
+          b->zero = tick - (restart + 1) * Prescale(b);
+          b->match = tick + (counts - 1 - restart) * Prescale(b);
+        }
+        b->busy = t + INT0_DURATION * b->scale;
+      } else {
+        b->ocf = false;
+        b->busy = t + b->ctcCycles() * b->scale;
+        if (who == 0) {
+          Ctc(0, t);
+        } else {
+          b->body = b->busy;
+          b->bodyStart = t;
+        }
+      }
+      break;
+    }
+  }
+
+  int frames = 0, missed = 0;
+  double maxSkew = 0, sumSkew = 0;
+  for (int k = 5; k < FRAMES; k++) {
+    double first = 1e300, last = -1e300;
+    bool all = true;
+    for (int i = 0; i < BOARDS; i++) {
+      if (!boards[i].flipped[k]) {
+        all = false;
+        break;
+      }
+      first = fmin(first, boards[i].flip[k]);
+      last = fmax(last, boards[i].flip[k]);
+    }
+    if (!all) {
+      missed++;
+      continue;
+    }
+    frames++;
+    sumSkew += last - first;
+    maxSkew = fmax(maxSkew, last - first);
+  }
+
+  static const char *names[] = { "no sync", "flips only", "flips and phase" };
+  printf("sync: %s, %d frames flipped everywhere, %d not\n", names[sync], frames, missed);
+  printf("sync: flip spread mean %.0f, max %.0f cycles, compare match spread max %.0f cycles (%.0f per count, %.0f per interrupt)\n",
+         frames ? sumSkew / frames : 0, maxSkew, maxMatchSkew, 64.0, period);
+
+  int failures = litErrors;
+  if (sync && missed) {
+    printf("sync: frames missed\n");
+    failures++;
+  }
+  if (sync == 1 && maxSkew >= period) {
+    printf("sync: flips more than one interrupt apart\n");
+    failures++;
+  }
+  if (sync == 2 && (maxSkew > SKEW_COUNTS * 64.0 || maxMatchSkew > SKEW_COUNTS * 64.0)) {
+    printf("sync: spread over %d counts\n", SKEW_COUNTS);
+    failures++;
+  }
+  printf("sync: %d failures\n", failures);
+  return failures != 0;
+}
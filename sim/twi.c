@@ -0,0 +1,210 @@
+/*
+
+  sim/twi.c
+
+  Copyright 2015 Matthew T. Pandina. All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY MATTHEW T. PANDINA "AS IS" AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHEW T. PANDINA OR
+  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+  USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+  SUCH DAMAGE.
+
+  --------------------------------------------------------------------
+
+  Drives ISR(TWI_vect) with a model of the TWI hardware in slave
+  receiver mode: each bus event is handed over the way the hardware
+  does, with its status in TWSR and the byte in TWDR, and whether the
+  next byte gets ACKed follows the TWEA bit the ISR writes back.
+
+  Random writes at random offsets must land in the back buffer, with
+  every byte past the end of the frame NACKed. Every few writes, general
+  calls carrying other commands (including the 0x06 reset from the I2C
+  specification) must be ignored, and one carrying TLC5940_TWI_COMMIT
+  must commit the frame, after which writes are NACKed until the CTC
+  interrupt has taken it. With TLC5940_ENABLE_POWER_GOVERNOR = 1, the
+  power totals must match a full recount after every write.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <util/delay_basic.h>
+#include <util/twi.h>
+#include "tlc5940.h"
+#include "sim.h"
+
+#define GENERAL_CALL 0x00
+
+#define STEPS 500
+
+static int failures;
+
+static void Fail(int step, const char *what) {
+  if (failures++ < 10)
+    printf("step %d: %s\n", step, what);
+}
+
+// Hands one bus event to the slave, and returns whether it will ACK the
+// next byte it receives
+static bool Event(uint8_t status, uint8_t data) {
+  TWSR = status;
+  TWDR = data;
+  TWCR |= (1 << TWINT);
+  TWI_vect();
+  return TWCR & (1 << TWEA);
+}
+
+// A master write of 'n' bytes to 'address'. Returns how many of them
+// were ACKed, or -1 if the address itself was not.
+static int Write(uint8_t address, const uint8_t *data, int n) {
+  bool general = (address == GENERAL_CALL);
+  if (general ? !(TWAR & (1 << TWGCE)) : address != (TWAR >> 1))
+    return -1;
+  if (!(TWCR & (1 << TWEA)))
+    return -1;
+
+  bool ack = Event(general ? TW_SR_GCALL_ACK : TW_SR_SLA_ACK, 0);
+  for (int i = 0; i < n; i++) {
+    if (!ack) {
+      // The slave drops off the bus after a NACK, so it never sees the stop
+      Event(general ? TW_SR_GCALL_DATA_NACK : TW_SR_DATA_NACK, data[i]);
+      return i;
+    }
+    ack = Event(general ? TW_SR_GCALL_DATA_ACK : TW_SR_DATA_ACK, data[i]);
+  }
+  Event(TW_SR_STOP, 0);
+  return n;
+}
+
+static int WriteAt(gsFrame_t offset, const uint8_t *data, int n) {
+  uint8_t buf[TLC5940_TWI_OFFSET_BYTES + TLC5940_FRAME_BYTES + 4];
+#if (TLC5940_TWI_OFFSET_BYTES == 2)
+  buf[0] = offset >> 8;
+  buf[1] = (uint8_t)offset;
+#else // TLC5940_TWI_OFFSET_BYTES
+  buf[0] = offset;
+#endif // TLC5940_TWI_OFFSET_BYTES
+  for (int i = 0; i < n; i++)
+    buf[TLC5940_TWI_OFFSET_BYTES + i] = data[i];
+  return Write(TLC5940_TWI_ADDRESS, buf, TLC5940_TWI_OFFSET_BYTES + n);
+}
+
+static bool Busy(void) {
+#if (TLC5940_ENABLE_FRAME_QUEUE)
+  return TLC5940_GetFrameQueueFull();
+#else // TLC5940_ENABLE_FRAME_QUEUE
+  return TLC5940_GetGSUpdateFlag();
+#endif // TLC5940_ENABLE_FRAME_QUEUE
+}
+
+// Runs the CTC interrupt until the committed frame has been taken
+static bool RunUntilIdle(void) {
+  for (int i = 0; Busy(); i++) {
+    if (i == 64)
+      return false;
+    TLC5940_TIMER_COMPA_vect();
+  }
+  return true;
+}
+
+static bool Committed(const uint8_t *back) {
+#if (TLC5940_ENABLE_FRAME_QUEUE)
+  return TLC5940_GS_BACK != back;
+#else // TLC5940_ENABLE_FRAME_QUEUE
+  (void)back;
+  return TLC5940_GetGSUpdateFlag();
+#endif // TLC5940_ENABLE_FRAME_QUEUE
+}
+
+int main(void) {
+  TLC5940_Init();
+  TLC5940_ClockInGS();
+  RunUntilIdle();
+  srand(1);
+
+  static uint8_t want[TLC5940_FRAME_BYTES];
+  for (gsFrame_t i = 0; i < TLC5940_FRAME_BYTES; i++)
+    want[i] = TLC5940_GS_BACK[i];
+
+  int commits = 0;
+  for (int step = 0; step < STEPS; step++) {
+    uint8_t data[TLC5940_FRAME_BYTES + 4];
+    gsFrame_t offset = rand() % TLC5940_FRAME_BYTES;
+    int n = rand() % (TLC5940_FRAME_BYTES + 4);
+    for (int i = 0; i < n; i++)
+      data[i] = rand();
+
+    int fit = TLC5940_FRAME_BYTES - offset;
+    if (WriteAt(offset, data, n) != TLC5940_TWI_OFFSET_BYTES + (n < fit ? n : fit))
+      Fail(step, "wrong number of bytes ACKed");
+    for (int i = 0; i < n && i < fit; i++)
+      want[offset + i] = data[i];
+    for (gsFrame_t i = 0; i < TLC5940_FRAME_BYTES; i++) {
+      if (TLC5940_GS_BACK[i] != want[i]) {
+        Fail(step, "back buffer differs from what was written");
+        break;
+      }
+    }
+
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+    uint32_t power = TLC5940_GetPower();
+    TLC5940_powerStale = TLC5940_POWER_ALL_STALE;
+    if (TLC5940_GetPower() != power)
+      Fail(step, "power totals are stale after a write");
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+
+    if (step % 7 != 6)
+      continue;
+
+    // Other devices' general calls, and the general call address alone
+    const uint8_t *back = TLC5940_GS_BACK;
+    const uint8_t foreign[] = { 0x06, 0x04, TLC5940_TWI_COMMIT | 1, TLC5940_TWI_COMMIT ^ 0x80 };
+    Write(GENERAL_CALL, foreign, 0);
+    for (uint8_t i = 0; i < sizeof(foreign); i++)
+      Write(GENERAL_CALL, &foreign[i], 1);
+    if (Committed(back))
+      Fail(step, "committed on a foreign general call");
+
+    const uint8_t commit = TLC5940_TWI_COMMIT;
+    if (Write(GENERAL_CALL, &commit, 1) != 1 || !Committed(back)) {
+      Fail(step, "no commit");
+      continue;
+    }
+    commits++;
+    if (Busy() && WriteAt(0, data, 1) != 0)
+      Fail(step, "write ACKed before the commit was taken");
+
+    if (!RunUntilIdle())
+      Fail(step, "commit never taken");
+    for (gsFrame_t i = 0; i < TLC5940_FRAME_BYTES; i++)
+      want[i] = TLC5940_GS_BACK[i];
+  }
+
+  // An offset past the end NACKs every data byte
+  uint8_t data = 0;
+  if (WriteAt(TLC5940_FRAME_BYTES, &data, 1) != TLC5940_TWI_OFFSET_BYTES)
+    Fail(STEPS, "data past the end of the frame ACKed");
+
+  printf("twi: %d writes, %d commits, %d failures\n", STEPS, commits, failures);
+  return failures != 0;
+}
@@ -0,0 +1,503 @@
+/*
+
+  tlc5940-bench.c
+
+  Copyright 2015 Matthew T. Pandina. All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY MATTHEW T. PANDINA "AS IS" AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHEW T. PANDINA OR
+  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+  USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+  SUCH DAMAGE.
+
+  --------------------------------------------------------------------
+
+  Measures how many clock cycles each call of the Set* functions takes,
+  with constant and with variable arguments, for whatever TLC5940_N and
+  TLC5940_INLINE_SET*_FUNCS it is built with, along with one pass of the
+  default ISR shifting out a frame for each TLC5940_UNROLL_SHIFT_LOOPS.
+  Each pass of the ISR is also reported per byte, checked against the
+  interrupt interval, and scaled up to the largest TLC5940_N that would
+  still fit into it, which is what to compare with the cost model that
+  TLC5940_TIMING_CHECK uses.
+  With TLC5940_INCLUDE_HSV = 1, it also times one HSV to grayscale
+  conversion, and with three or more rows, TLC5940_SetAllHSV() per pixel.
+  With TLC5940_INCLUDE_COLOR_MATRIX = 1, it times TLC5940_SetAllRGB() per
+  pixel. For both, it also reports the largest TLC5940_N that could be
+  converted at 60 fps in the time the ISR leaves over, F_CPU / (per
+  pixel * 16 * 60 + the ISR's cycles per second per chip).
+  With TLC5940_INCLUDE_BOOT_FRAME = 1, it times clocking in a boot frame
+  (with its DC, if TLC5940_INCLUDE_DC_FUNCS = 1), both on its own and,
+  as the first thing main() does, from reset to BLANK going low, along
+  with the part of that spent before main() (which mostly depends on the
+  size of .data and .bss). "make bench" does this in every SPI mode. With
+  TLC5940_ENABLE_STATUS_READBACK = 1, the ISR is timed a second time
+  while it captures the status information. With
+  TLC5940_ENABLE_MASTER_BRIGHTNESS = 1, it times
+  TLC5940_ApplyMasterBrightness() scaling the frame, also per TLC5940 and
+  row, and copying it at full brightness.
+  With TLC5940_ENABLE_RENDER = 1, there are no Set*GS functions, and
+  only the ISR is timed, rendering the frame with the example callback
+  in tlc5940-render.h. "make bench" builds it for every width class of
+  channel_t and gsData_t with each inlining and unrolling choice, again
+  with three rows, again with master brightness for every TLC5940_N, and
+  again in render mode, prints the flash each build takes, and runs it
+  in simulavr:
+
+    simulavr -d atmega328 -F F_CPU -W 0x4b,- -T exit -f tlc5940-bench.elf
+
+  Render mode is also built and run with tlc5940-attiny85.mk, for the
+  ATtiny85 and its USI (TLC5940_SPI_MODE = 2):
+
+    simulavr -d attiny85 -F F_CPU -W 0x33,- -T exit -f tlc5940-bench.elf
+
+  In render mode, one call of TLC5940_Render() is timed as well, and
+  checked against TLC5940_RENDER_CYCLES, and the ISR is checked against
+  the interrupt interval, (TLC5940_CTC_TOP + 1) * 64 clock cycles.
+
+  Timer1 counts every clock cycle, and the cost of reading it is
+  subtracted, so each result is within a cycle or two of the call itself.
+  The ATtiny85 has no 16-bit timer, so there Timer0 counts the low byte
+  of the clock cycles, and Timer1, started along with it at clk_io / 256,
+  the high byte.
+  The report is written one character at a time to GPIOR2 (data address
+  0x4b on the ATmega328P, 0x33 on the ATtiny85), which simulavr's -W
+  option copies to stdout. Nothing is written
+  to the TLC5940s but the ISR's frame, and interrupts stay disabled
+  throughout, apart from the moment between the ISR's reti and the cli
+  after it.
+
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/delay_basic.h>
+#include "tlc5940.h"
+
+#if (TLC5940_ENABLE_POV || TLC5940_GSCLK_DIVIDER > 1)
+#error "tlc5940-bench.c needs Timer1 to itself"
+#endif // TLC5940_ENABLE_POV
+
+#if (TLC5940_ENABLE_RENDER)
+#include "tlc5940-render.h"
+
+// The channel that TLC5940_Render() lights up
+volatile channel_t renderChannel;
+#endif // TLC5940_ENABLE_RENDER
+
+// Read through volatiles, so the compiler can't treat them as constants
+volatile uint8_t benchRow = 0;
+volatile channel_t benchChannel = 1;
+volatile uint16_t benchValue = 2047;
+
+static uint16_t overhead;
+
+static void Put(char c) {
+  GPIOR2 = c;
+}
+
+static void PutString(const char *s) {
+  while (*s)
+    Put(*s++);
+}
+
+static void PutNumber(uint16_t n) {
+  char digits[5];
+  uint8_t i = 0;
+  do {
+    digits[i++] = '0' + n % 10;
+    n /= 10;
+  } while (n);
+  while (i)
+    Put(digits[--i]);
+}
+
+static void Report(const char *name, uint16_t cycles) {
+  PutString(name);
+  Put(' ');
+  PutNumber(cycles - overhead);
+  Put('\n');
+}
+
+// Whether any function that sets every pixel at once is timed
+#define BENCH_PIXELS ((TLC5940_INCLUDE_HSV && TLC5940_ENABLE_MULTIPLEXING && TLC5940_MULTIPLEX_N >= 3) || TLC5940_INCLUDE_COLOR_MATRIX)
+
+#if (TLC5940_ENABLE_MULTIPLEXING && TLC5940_MULTIPLEX_N >= 3)
+// For the functions that set every pixel (a channel of rows 0, 1 and 2)
+// at once, reports and returns the cycles per pixel
+static uint16_t ReportPerPixel(const char *name, uint16_t cycles) {
+  cycles = (cycles - overhead) / TLC5940_CHANNELS_N;
+  PutString(name);
+  PutString(" per pixel ");
+  PutNumber(cycles);
+  Put('\n');
+  return cycles;
+}
+#endif // TLC5940_ENABLE_MULTIPLEXING
+
+#if (TLC5940_INCLUDE_DEFAULT_ISR)
+// Clock cycles between two interrupts, which one pass of the ISR has to
+// fit into (the bench rejects TLC5940_GSCLK_DIVIDER > 1). Unless
+// TLC5940_PWM_BITS = 0, (TLC5940_CTC_TOP + 1) * 64 is 2^TLC5940_PWM_BITS.
+#if (TLC5940_ENABLE_PWM_SWITCHING)
+#define BENCH_ISR_PERIOD ((uint16_t)1 << TLC5940_PWM_BITS_MIN)
+#elif (TLC5940_PWM_BITS == 0)
+#define BENCH_ISR_PERIOD ((uint16_t)(TLC5940_CTC_TOP + 1) * 64)
+#else // TLC5940_ENABLE_PWM_SWITCHING
+#define BENCH_ISR_PERIOD ((uint16_t)1 << TLC5940_PWM_BITS)
+#endif // TLC5940_ENABLE_PWM_SWITCHING
+
+// For a pass of the ISR, also reports its cycles per byte shifted out,
+// whether it fits into the interrupt interval, and the largest
+// TLC5940_N that would, if the whole pass grew with TLC5940_N (so that
+// figure errs on the low side)
+static void ReportISR(const char *name, uint16_t cycles) {
+  Report(name, cycles);
+  cycles -= overhead;
+  PutString(name);
+  PutString(" per byte ");
+  PutNumber(cycles / TLC5940_GRAYSCALE_BYTES);
+  Put('.');
+  PutNumber((uint16_t)((uint32_t)(cycles % TLC5940_GRAYSCALE_BYTES) * 10 / TLC5940_GRAYSCALE_BYTES));
+  PutString(cycles <= BENCH_ISR_PERIOD ? ", fits " : ", OVERRUNS ");
+  PutNumber(BENCH_ISR_PERIOD);
+  PutString(", largest TLC5940_N ");
+  PutNumber((uint16_t)((uint32_t)BENCH_ISR_PERIOD * TLC5940_N / cycles));
+  Put('\n');
+}
+#endif // TLC5940_INCLUDE_DEFAULT_ISR
+
+#if (BENCH_PIXELS)
+// Reports the largest TLC5940_N whose 16 pixels per chip could all be
+// converted 60 times a second at 'perPixel' cycles each, in the time the
+// ISR leaves over. The ISR's share is scaled up from 'isr', the cycles of
+// one of its passes at this TLC5940_N, as if the whole pass grew with
+// TLC5940_N.
+static void ReportFPS(const char *name, uint16_t perPixel, uint16_t isr) {
+  uint32_t perChip = (uint32_t)perPixel * 16 * 60;
+#if (TLC5940_INCLUDE_DEFAULT_ISR)
+  perChip += (uint32_t)(F_CPU / BENCH_ISR_PERIOD) * isr / TLC5940_N;
+#else // TLC5940_INCLUDE_DEFAULT_ISR
+  (void)isr;
+#endif // TLC5940_INCLUDE_DEFAULT_ISR
+  PutString(name);
+  PutString(" largest TLC5940_N at 60 fps ");
+  PutNumber((uint16_t)(F_CPU / perChip));
+  Put('\n');
+}
+#endif // BENCH_PIXELS
+
+#if (TLC5940_SPI_MODE == 2)
+// The clock cycles counted by Timer0 (low byte) and Timer1 (high byte).
+// Timer1 is read on both sides of TCNT0, and the read on the side of the
+// carry that TCNT0 says has (or hasn't) happened yet is kept.
+static inline uint16_t BenchNow(void) __attribute__(( always_inline ));
+static inline uint16_t BenchNow(void) {
+  uint8_t before = TCNT1;
+  uint8_t low = TCNT0;
+  uint8_t after = TCNT1;
+  return ((uint16_t)(low < 128 ? after : before) << 8) | low;
+}
+#else // TLC5940_SPI_MODE
+#define BenchNow() TCNT1
+#endif // TLC5940_SPI_MODE
+
+// Times 'call' with Timer1. The barriers keep the compiler from moving
+// any stores of the call outside of the two reads of the timer.
+#define BENCH(cycles, call) do {                               \
+                              uint16_t start = BenchNow();     \
+                              __asm__ volatile ("" ::: "memory"); \
+                              call;                            \
+                              __asm__ volatile ("" ::: "memory"); \
+                              cycles = BenchNow() - start;     \
+                            } while (0)
+
+#if (TLC5940_INCLUDE_DEFAULT_ISR)
+// Called directly, rather than from its interrupt
+void TLC5940_TIMER_COMPA_vect(void);
+#endif // TLC5940_INCLUDE_DEFAULT_ISR
+
+#if (TLC5940_ENABLE_MULTIPLEXING)
+#define ROW(row) (row),
+#else // TLC5940_ENABLE_MULTIPLEXING
+#define ROW(row)
+#endif // TLC5940_ENABLE_MULTIPLEXING
+
+#if (BENCH_PIXELS)
+// One color per pixel, shared by every function that sets them all, since
+// RAM is already tight with three rows
+static union {
+#if (TLC5940_INCLUDE_HSV)
+  TLC5940_HSV_t hsv[TLC5940_CHANNELS_N];
+#endif // TLC5940_INCLUDE_HSV
+#if (TLC5940_INCLUDE_COLOR_MATRIX)
+  uint8_t rgb[3 * TLC5940_CHANNELS_N];
+#endif // TLC5940_INCLUDE_COLOR_MATRIX
+} benchPixels;
+#endif // TLC5940_INCLUDE_HSV
+
+#if (TLC5940_INCLUDE_BOOT_FRAME)
+// All zeroes take just as long to clock in as any other boot frame
+static const uint8_t bootGS[TLC5940_FRAME_BYTES] PROGMEM = { 0 };
+#if (TLC5940_INCLUDE_DC_FUNCS)
+static const uint8_t bootDC[TLC5940_DOT_CORRECTION_BYTES] PROGMEM = { 0 };
+#define BENCH_BOOT_FRAME() TLC5940_ClockInBootFrame(bootGS, bootDC)
+#else // TLC5940_INCLUDE_DC_FUNCS
+#define BENCH_BOOT_FRAME() TLC5940_ClockInBootFrame(bootGS)
+#endif // TLC5940_INCLUDE_DC_FUNCS
+
+// Starts Timer1 right after reset, before the C runtime copies .data and
+// clears .bss, so that the boot frame can be timed from reset. It runs at
+// clk_io on the ATmega328P, and at clk_io / 256 on the ATtiny85, whose
+// Timer0 isn't free until main() has set it up again after
+// TLC5940_Init().
+static void BenchStartAtReset(void) __attribute__(( naked, used, section(".init3") ));
+static void BenchStartAtReset(void) {
+#if (TLC5940_SPI_MODE == 2)
+  TCCR1 = (1 << CS13) | (1 << CS10);
+#else // TLC5940_SPI_MODE
+  TCCR1B = (1 << CS10);
+#endif // TLC5940_SPI_MODE
+}
+
+// Clock cycles since reset, rounded up to a multiple of 256 on the
+// ATtiny85
+#if (TLC5940_SPI_MODE == 2)
+#define BenchSinceReset() ((uint16_t)(TCNT1 + 1) << 8)
+#else // TLC5940_SPI_MODE
+#define BenchSinceReset() TCNT1
+#endif // TLC5940_SPI_MODE
+#endif // TLC5940_INCLUDE_BOOT_FRAME
+
+int main(void) {
+  uint16_t cycles;
+#if (BENCH_PIXELS)
+  uint16_t isr = 0;
+#endif // BENCH_PIXELS
+#if (TLC5940_INCLUDE_HSV && TLC5940_ENABLE_MULTIPLEXING && TLC5940_MULTIPLEX_N >= 3)
+  uint16_t hsvPerPixel;
+#endif // TLC5940_INCLUDE_HSV
+#if (TLC5940_INCLUDE_COLOR_MATRIX)
+  uint16_t rgbPerPixel;
+#endif // TLC5940_INCLUDE_COLOR_MATRIX
+
+#if (TLC5940_INCLUDE_BOOT_FRAME)
+  // What an application that boots straight into a stored frame does
+  // first, timed from reset to BLANK going low, when the frame lights up
+  uint16_t atMain = BenchSinceReset();
+  TLC5940_Init();
+  BENCH_BOOT_FRAME();
+  uint16_t atPhoton = BenchSinceReset();
+#else // TLC5940_INCLUDE_BOOT_FRAME
+  TLC5940_Init();
+#endif // TLC5940_INCLUDE_BOOT_FRAME
+
+#if (TLC5940_SPI_MODE == 2)
+  // The ISR's own interrupt must not fire once its reti enables
+  // interrupts. Timer0 at clk_io in normal mode, instead of the ISR's
+  // CTC, and Timer1 at clk_io / 256, both held and cleared, and then
+  // started on the same clock cycle.
+  TIMSK = 0;
+  GTCCR = (1 << TSM) | (1 << PSR1) | (1 << PSR0);
+  TCCR0A = 0;
+  TCCR0B = (1 << CS00);
+  TCCR1 = (1 << CS13) | (1 << CS10);
+  TCNT0 = 0;
+  TCNT1 = 0;
+  GTCCR = 0;
+#else // TLC5940_SPI_MODE
+  // Timer1 at clk_io, with nothing else using it
+  TCCR1A = 0;
+  TCCR1B = (1 << CS10);
+
+#if (TLC5940_INCLUDE_DEFAULT_ISR)
+  // The ISR's own interrupt must not fire once its reti enables interrupts
+  TIMSK0 = 0;
+  TIMSK2 = 0;
+#endif // TLC5940_INCLUDE_DEFAULT_ISR
+#endif // TLC5940_SPI_MODE
+
+  BENCH(overhead, (void)0);
+
+  PutString("TLC5940_N ");
+  PutNumber(TLC5940_N);
+  PutString("\nchannel_t ");
+  PutNumber(8 * sizeof(channel_t));
+  PutString("\ngsData_t ");
+  PutNumber(8 * sizeof(gsData_t));
+#if (TLC5940_ENABLE_RENDER == 0)
+  PutString("\nTLC5940_INLINE_SETGS_FUNCS ");
+  PutNumber(TLC5940_INLINE_SETGS_FUNCS);
+  Put('\n');
+
+  uint8_t row = benchRow;
+  channel_t channel = benchChannel;
+  uint16_t value = benchValue;
+  (void)row;
+
+  BENCH(cycles, TLC5940_SetGS(ROW(0) TLC5940_CHANNELS_N - 2, 2047));
+  Report("SetGS const", cycles);
+  BENCH(cycles, TLC5940_SetGS(ROW(row) channel, value));
+  Report("SetGS var", cycles);
+  BENCH(cycles, TLC5940_SetAllGS(ROW(0) 2047));
+  Report("SetAllGS const", cycles);
+  BENCH(cycles, TLC5940_SetAllGS(ROW(row) value));
+  Report("SetAllGS var", cycles);
+#if (TLC5940_INCLUDE_SET4_FUNCS)
+  BENCH(cycles, TLC5940_Set4GS(ROW(0) TLC5940_CHANNELS_N / 4 - 1, 2047));
+  Report("Set4GS const", cycles);
+  BENCH(cycles, TLC5940_Set4GS(ROW(row) channel, value));
+  Report("Set4GS var", cycles);
+#endif // TLC5940_INCLUDE_SET4_FUNCS
+
+#if (TLC5940_INCLUDE_HSV)
+  uint16_t r, g, b;
+  BENCH(cycles, TLC5940_HSVtoGS(value << 4, 255, (uint8_t)value, &r, &g, &b));
+  Report("HSVtoGS var", cycles);
+#if (TLC5940_ENABLE_MULTIPLEXING && TLC5940_MULTIPLEX_N >= 3)
+  // A rainbow, so every pixel isn't the same sector of the color wheel
+  for (channel_t i = 0; i < TLC5940_CHANNELS_N; i++) {
+    benchPixels.hsv[i].hue = (uint16_t)(i * (65536UL / TLC5940_CHANNELS_N));
+    benchPixels.hsv[i].saturation = 255 - (uint8_t)i;
+    benchPixels.hsv[i].value = 255;
+  }
+  BENCH(cycles, TLC5940_SetAllHSV(benchPixels.hsv));
+  hsvPerPixel = ReportPerPixel("SetAllHSV", cycles);
+#endif // TLC5940_ENABLE_MULTIPLEXING
+#endif // TLC5940_INCLUDE_HSV
+
+#if (TLC5940_INCLUDE_COLOR_MATRIX)
+  // Ramps of red, green and blue through the default identity matrix,
+  // which costs the same as any other
+  for (uint16_t i = 0; i < 3 * TLC5940_CHANNELS_N; i++)
+    benchPixels.rgb[i] = (uint8_t)(i * 7);
+  BENCH(cycles, TLC5940_SetAllRGB(benchPixels.rgb));
+  rgbPerPixel = ReportPerPixel("SetAllRGB", cycles);
+#endif // TLC5940_INCLUDE_COLOR_MATRIX
+#else // TLC5940_ENABLE_RENDER
+  PutString("\nTLC5940_RENDER_CYCLES ");
+  PutNumber(TLC5940_RENDER_CYCLES);
+  Put('\n');
+
+  // One call of the example callback, for the output that it lights up.
+  // The empty asm only makes the result count as used.
+  channel_t channel = benchChannel;
+  uint8_t chip = channel / 16, output = channel % 16;
+  uint16_t value;
+  renderChannel = channel;
+  BENCH(cycles, value = TLC5940_Render(chip, output); __asm__ volatile ("" : "+r" (value)));
+  Report("Render", cycles);
+  PutString(cycles - overhead <= TLC5940_RENDER_CYCLES ? "Render fits " : "Render EXCEEDS ");
+  PutString("TLC5940_RENDER_CYCLES\n");
+#endif // TLC5940_ENABLE_RENDER
+
+#if (TLC5940_INCLUDE_DC_FUNCS)
+  PutString("TLC5940_INLINE_SETDC_FUNCS ");
+  PutNumber(TLC5940_INLINE_SETDC_FUNCS);
+  Put('\n');
+
+  uint8_t dc = (uint8_t)value & 0x3F;
+  BENCH(cycles, TLC5940_SetDC(TLC5940_CHANNELS_N - 2, 31));
+  Report("SetDC const", cycles);
+  BENCH(cycles, TLC5940_SetDC(channel, dc));
+  Report("SetDC var", cycles);
+  BENCH(cycles, TLC5940_SetAllDC(31));
+  Report("SetAllDC const", cycles);
+  BENCH(cycles, TLC5940_SetAllDC(dc));
+  Report("SetAllDC var", cycles);
+#if (TLC5940_INCLUDE_SET4_FUNCS)
+  BENCH(cycles, TLC5940_Set4DC(TLC5940_CHANNELS_N / 4 - 1, 31));
+  Report("Set4DC const", cycles);
+  BENCH(cycles, TLC5940_Set4DC(channel, dc));
+  Report("Set4DC var", cycles);
+#endif // TLC5940_INCLUDE_SET4_FUNCS
+#endif // TLC5940_INCLUDE_DC_FUNCS
+
+#if (TLC5940_INCLUDE_BOOT_FRAME)
+  BENCH(cycles, BENCH_BOOT_FRAME());
+  Report("ClockInBootFrame", cycles);
+  PutString("Reset to main ");
+  PutNumber(atMain);
+  PutString("\nReset to BLANK low ");
+  PutNumber(atPhoton);
+  Put('\n');
+#endif // TLC5940_INCLUDE_BOOT_FRAME
+
+#if (TLC5940_ENABLE_MASTER_BRIGHTNESS)
+  // Every row is scaled from the unscaled frame into the one shown next,
+  // and at full brightness, only copied
+  TLC5940_SetMasterBrightness(128);
+  BENCH(cycles, TLC5940_ApplyMasterBrightness());
+  Report("ApplyMasterBrightness", cycles);
+  // Per row and TLC5940, to hold up against the estimate in the .mk file
+  PutString("ApplyMasterBrightness per chip per row ");
+  PutNumber((cycles - overhead) / (TLC5940_FRAME_BYTES / 24));
+  Put('\n');
+  TLC5940_SetMasterBrightness(255);
+  BENCH(cycles, TLC5940_ApplyMasterBrightness());
+  Report("ApplyMasterBrightness 255", cycles);
+#endif // TLC5940_ENABLE_MASTER_BRIGHTNESS
+
+#if (TLC5940_INCLUDE_DEFAULT_ISR)
+#if (TLC5940_ENABLE_RENDER)
+  // The ISR renders every output as it shifts them out, with the one
+  // lit output in the middle of the frame
+  renderChannel = TLC5940_CHANNELS_N / 2;
+  TLC5940_SetGSUpdateFlag();
+  BENCH(cycles, TLC5940_TIMER_COMPA_vect(); cli());
+  ReportISR("ISR render", cycles);
+#else // TLC5940_ENABLE_RENDER
+  PutString("TLC5940_UNROLL_SHIFT_LOOPS ");
+  PutNumber(TLC5940_UNROLL_SHIFT_LOOPS);
+  Put('\n');
+
+  // With new data waiting, the ISR shifts out a whole frame (or row)
+  TLC5940_SetGSUpdateFlag();
+  BENCH(cycles, TLC5940_TIMER_COMPA_vect(); cli());
+  ReportISR("ISR", cycles);
+#if (BENCH_PIXELS)
+  isr = cycles - overhead;
+#endif // BENCH_PIXELS
+
+#if (TLC5940_ENABLE_STATUS_READBACK)
+  // The same pass again, storing each byte of status information that
+  // the TLC5940s shift back out as the frame goes in
+  TLC5940_RequestStatus();
+  TLC5940_SetGSUpdateFlag();
+  BENCH(cycles, TLC5940_TIMER_COMPA_vect(); cli());
+  ReportISR("ISR status", cycles);
+#endif // TLC5940_ENABLE_STATUS_READBACK
+#endif // TLC5940_ENABLE_RENDER
+#endif // TLC5940_INCLUDE_DEFAULT_ISR
+
+  // Known only now that the ISR has been timed
+#if (TLC5940_INCLUDE_HSV && TLC5940_ENABLE_MULTIPLEXING && TLC5940_MULTIPLEX_N >= 3)
+  ReportFPS("SetAllHSV", hsvPerPixel, isr);
+#endif // TLC5940_INCLUDE_HSV
+#if (TLC5940_INCLUDE_COLOR_MATRIX)
+  ReportFPS("SetAllRGB", rgbPerPixel, isr);
+#endif // TLC5940_INCLUDE_COLOR_MATRIX
+
+  Put('\n');
+  return 0;
+}
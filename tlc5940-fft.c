@@ -0,0 +1,285 @@
+/*
+
+  tlc5940-fft.c
+
+  Copyright 2015 Matthew T. Pandina. All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY MATTHEW T. PANDINA "AS IS" AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHEW T. PANDINA OR
+  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+  USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+  SUCH DAMAGE.
+
+  --------------------------------------------------------------------
+
+  Runs the audio pipeline of TLC5940_ENABLE_AUDIO on a PC, built from
+  the same tlc5940.c against the model of the ATmega328P's registers in
+  sim/. Build it with "make tlc5940-fft", which uses the audio settings
+  from the .mk file, and run:
+
+    tlc5940-fft [file.wav]
+
+  Without a file, it checks TLC5940_Audio_FFT() against a DFT done in
+  floating point, on random blocks and on a sine wave in every bin, and
+  checks that a tone in the middle of each band comes out loudest in
+  that band. It prints the worst error, and how long the FFT and
+  TLC5940_Audio_Process() take on the PC next to the time the ADC takes
+  to fill a block. It fails if the error is over ERROR_LIMIT, or a tone
+  lands in the wrong band.
+
+  With a file (PCM, 8 or 16 bits), the audio is mixed down to mono,
+  resampled to the ADC's sample rate, and fed through ISR(ADC_vect) one
+  sample at a time, the way the ADC delivers it. It prints the time and
+  every band level after each block TLC5940_Audio_Process() takes.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <avr/io.h>
+#include <util/delay_basic.h>
+#include "tlc5940.h"
+#include "sim.h"
+
+#define SAMPLE_RATE ((double)F_CPU / TLC5940_AUDIO_ADC_PRESCALER / 13)
+#define N TLC5940_AUDIO_FFT_N
+
+// Worst distance from the DFT allowed, out of inputs within +/-8192
+#define ERROR_LIMIT 16.0
+
+#define RANDOM_BLOCKS 200
+#define TIMING_RUNS 20000
+
+// This must match audioBandEdges in tlc5940.c
+#if (N == 64)
+static const int bandEdges[TLC5940_AUDIO_BANDS_N + 1] = { 1, 2, 3, 4, 6, 9, 14, 21, 32 };
+#else // N
+static const int bandEdges[TLC5940_AUDIO_BANDS_N + 1] = { 1, 2, 3, 5, 8, 13, 21, 34, 64 };
+#endif // N
+
+static double Seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// One ADC conversion, with 'x' between -1 and 1
+static void Convert(double x) {
+  long value = lrint(128 + 127 * x);
+  ADCH = (value < 0) ? 0 : (value > 255) ? 255 : value;
+  ADC_vect();
+}
+
+// Distance of the FFT of 'x' from its DFT, divided by N
+static double Check(const double *x) {
+  int16_t re[N], im[N];
+  for (int i = 0; i < N; i++) {
+    re[i] = lrint(x[i]);
+    im[i] = 0;
+  }
+  TLC5940_Audio_FFT(re, im);
+
+  double worst = 0;
+  for (int k = 0; k < N; k++) {
+    double a = 0, b = 0;
+    for (int i = 0; i < N; i++) {
+      a += x[i] * cos(2 * M_PI * k * i / N);
+      b -= x[i] * sin(2 * M_PI * k * i / N);
+    }
+    double error = hypot(a / N - re[k], b / N - im[k]);
+    if (error > worst)
+      worst = error;
+  }
+  return worst;
+}
+
+static int SelfTest(void) {
+  int failures = 0;
+  srand(1);
+
+  double worst = 0;
+  double x[N];
+  for (int k = 0; k < N; k++) {
+    for (int i = 0; i < N; i++)
+      x[i] = 8000 * sin(2 * M_PI * k * i / N + 0.3);
+    worst = fmax(worst, Check(x));
+  }
+  for (int block = 0; block < RANDOM_BLOCKS; block++) {
+    for (int i = 0; i < N; i++)
+      x[i] = rand() % 16001 - 8000;
+    worst = fmax(worst, Check(x));
+  }
+  printf("fft: %d points, worst error %.1f (inputs within +/-8192)\n", N, worst);
+  if (worst > ERROR_LIMIT) {
+    printf("fft: error over %.0f\n", ERROR_LIMIT);
+    failures++;
+  }
+
+  // A tone in the middle bin of each band, with the levels cleared first
+  // so that the last band's decay doesn't get in the way
+  for (int band = 0; band < TLC5940_AUDIO_BANDS_N; band++) {
+    int bin = (bandEdges[band] + bandEdges[band + 1] - 1) / 2;
+    double frequency = bin * SAMPLE_RATE / N;
+    memset(TLC5940_audioLevel, 0, sizeof(TLC5940_audioLevel));
+    for (long i = 0; i < 4 * N; i++) {
+      Convert(0.9 * sin(2 * M_PI * frequency * i / SAMPLE_RATE));
+      TLC5940_Audio_Process();
+    }
+    int loudest = 0;
+    printf("fft: %6.0f Hz:", frequency);
+    for (int b = 0; b < TLC5940_AUDIO_BANDS_N; b++) {
+      printf(" %4u", TLC5940_audioLevel[b]);
+      if (TLC5940_audioLevel[b] > TLC5940_audioLevel[loudest])
+        loudest = b;
+    }
+    printf("%s\n", (loudest == band) ? "" : "  wrong band");
+    if (loudest != band)
+      failures++;
+  }
+
+  int16_t input[N], re[N], im[N];
+  for (int i = 0; i < N; i++)
+    input[i] = rand() % 16001 - 8000;
+  double start = Seconds();
+  for (int run = 0; run < TIMING_RUNS; run++) {
+    memcpy(re, input, sizeof(re));
+    memset(im, 0, sizeof(im));
+    TLC5940_Audio_FFT(re, im);
+  }
+  double fft = (Seconds() - start) / TIMING_RUNS;
+  start = Seconds();
+  for (int run = 0; run < TIMING_RUNS; run++) {
+    for (int i = 0; i < N; i++)
+      Convert(input[i] / 8192.0);
+    TLC5940_Audio_Process();
+  }
+  double process = (Seconds() - start) / TIMING_RUNS;
+  printf("fft: %.2f us per FFT, %.2f us per block processed (with its ADC interrupts), "
+         "on this PC; the ADC fills a block every %.2f ms\n",
+         fft * 1e6, process * 1e6, N / SAMPLE_RATE * 1e3);
+
+  printf("fft: %d failures\n", failures);
+  return failures != 0;
+}
+
+static uint32_t Little(const uint8_t *p, int n) {
+  uint32_t value = 0;
+  for (int i = n - 1; i >= 0; i--)
+    value = (value << 8) | p[i];
+  return value;
+}
+
+static int Play(const char *path) {
+  FILE *in = fopen(path, "rb");
+  if (!in) {
+    perror(path);
+    return 1;
+  }
+
+  uint8_t header[12];
+  if (fread(header, 1, 12, in) != 12 || memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4)) {
+    fprintf(stderr, "%s: not a .wav file\n", path);
+    return 1;
+  }
+
+  // Find the format, then the samples
+  int channels = 0, bits = 0;
+  double rate = 0;
+  uint8_t *data = NULL;
+  uint32_t size = 0;
+  uint8_t chunk[8];
+  while (!data && fread(chunk, 1, 8, in) == 8) {
+    uint32_t n = Little(chunk + 4, 4);
+    uint8_t *body = malloc(n + 1);
+    if (fread(body, 1, n + (n & 1), in) < n) {
+      free(body);
+      break;
+    }
+    if (memcmp(chunk, "fmt ", 4) == 0 && n >= 16) {
+      int format = Little(body, 2);
+      channels = Little(body + 2, 2);
+      rate = Little(body + 4, 4);
+      bits = Little(body + 14, 2);
+      if ((format != 1 && format != 0xFFFE) || (bits != 8 && bits != 16) || channels < 1) {
+        fprintf(stderr, "%s: only 8 and 16 bit PCM is supported\n", path);
+        return 1;
+      }
+      free(body);
+    } else if (memcmp(chunk, "data", 4) == 0 && channels) {
+      data = body;
+      size = n;
+    } else {
+      free(body);
+    }
+  }
+  if (!data) {
+    fprintf(stderr, "%s: no samples found\n", path);
+    return 1;
+  }
+
+  int frameBytes = channels * bits / 8;
+  long frames = size / frameBytes;
+  double *mono = malloc((frames + 1) * sizeof(double));
+  for (long i = 0; i < frames; i++) {
+    double sum = 0;
+    for (int c = 0; c < channels; c++) {
+      const uint8_t *p = data + i * frameBytes + c * bits / 8;
+      sum += (bits == 8) ? (p[0] - 128) / 128.0 : (int16_t)Little(p, 2) / 32768.0;
+    }
+    mono[i] = sum / channels;
+  }
+  mono[frames] = frames ? mono[frames - 1] : 0;
+
+  printf("%s: %d channels, %.0f Hz, %d bits, %.2f s, resampled to %.0f Hz\n",
+         path, channels, rate, bits, frames / rate, SAMPLE_RATE);
+  printf("  time");
+  for (int band = 0; band < TLC5940_AUDIO_BANDS_N; band++)
+    printf("  %5.0f", bandEdges[band] * SAMPLE_RATE / N);
+  printf(" Hz\n");
+
+  // Linear interpolation between the file's samples
+  long samples = (long)(frames / rate * SAMPLE_RATE);
+  for (long i = 0; i < samples; i++) {
+    double t = i * rate / SAMPLE_RATE;
+    long j = (long)t;
+    Convert(mono[j] + (mono[j + 1] - mono[j]) * (t - j));
+    if (TLC5940_Audio_Process()) {
+      printf("%6.3f", (i + 1) / SAMPLE_RATE);
+      for (int band = 0; band < TLC5940_AUDIO_BANDS_N; band++)
+        printf("  %5u", TLC5940_audioLevel[band]);
+      printf("\n");
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 2 || (argc == 2 && argv[1][0] == '-')) {
+    fprintf(stderr, "usage: %s [file.wav]\n", argv[0]);
+    return 2;
+  }
+  TLC5940_Init();
+  return (argc == 2) ? Play(argv[1]) : SelfTest();
+}
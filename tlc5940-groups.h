@@ -0,0 +1,61 @@
+/*
+
+  tlc5940-groups.h
+
+  Copyright 2015 Matthew T. Pandina. All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY MATTHEW T. PANDINA "AS IS" AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHEW T. PANDINA OR
+  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+  USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+  SUCH DAMAGE.
+
+  --------------------------------------------------------------------
+
+  Describes which outputs of each TLC5940 are connected together to
+  drive the same load, when TLC5940_INCLUDE_GROUP_FUNCS = 1. Every chip
+  is ganged the same way. TLC5940_GROUP_<n>(X) lists the outputs (0-15)
+  of group n as X(output), in any order, and a group's outputs don't
+  need to be next to each other. An output must not be in more than one
+  group.
+
+  For each group, TLC5940_SetGroupGS() and TLC5940_SetGroupDC() compile
+  down to a fixed sequence of byte stores, and
+  TLC5940_SetAllGroupsGS() and TLC5940_SetAllGroupsDC() set every group
+  of every chip from an array, one chip at a time.
+
+*/
+
+#pragma once
+
+// Number of groups per chip, between 1 and 16
+#define TLC5940_GROUPS_N 5
+
+// Outputs 0-1 and 2-3 ganged in pairs
+#define TLC5940_GROUP_0(X) X(0) X(1)
+#define TLC5940_GROUP_1(X) X(2) X(3)
+
+// Outputs 4-11 ganged together
+#define TLC5940_GROUP_2(X) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11)
+
+// Every other output of the last four
+#define TLC5940_GROUP_3(X) X(12) X(14)
+#define TLC5940_GROUP_4(X) X(13) X(15)
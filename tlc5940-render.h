@@ -0,0 +1,56 @@
+/*
+
+  tlc5940-render.h
+
+  Copyright 2015 Matthew T. Pandina. All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY MATTHEW T. PANDINA "AS IS" AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHEW T. PANDINA OR
+  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+  USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+  SUCH DAMAGE.
+
+  --------------------------------------------------------------------
+
+  Render callback used when TLC5940_ENABLE_RENDER = 1. The default ISR
+  calls TLC5940_Render() for every output, last chip and last output
+  first, each time it shifts out new grayscale data, so the value of an
+  output is whatever this returns at that moment. Replace the example
+  below with your own pattern, which may read tables in PROGMEM,
+  counters, or any other state that the main loop only changes while
+  TLC5940_GetGSUpdateFlag() is false.
+
+  Keep it short, since it is called 16 * TLC5940_N times per update
+  from inside the ISR, and set TLC5940_RENDER_CYCLES to roughly how many
+  clock cycles it takes, so that TLC5940_TIMING_CHECK can account for it.
+
+*/
+
+#pragma once
+
+// The example lights up a single channel at full brightness, which the
+// demo in main.c sweeps back and forth
+extern volatile channel_t renderChannel;
+
+static inline uint16_t TLC5940_Render(uint8_t chip, uint8_t output) __attribute__(( always_inline ));
+static inline uint16_t TLC5940_Render(uint8_t chip, uint8_t output) {
+  return ((channel_t)((channel_t)chip * 16 + output) == renderChannel) ? 4095 : 0;
+}
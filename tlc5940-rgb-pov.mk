@@ -39,6 +39,17 @@ TLC5940_INCLUDE_DC_FUNCS = 1
 #       connected in parallel to the same load.
 TLC5940_INCLUDE_SET4_FUNCS = 0
 
+# Flag for including functions for setting the grayscale (and optionally
+# dot correction) values of arbitrary groups of outputs at once, which
+# generalizes the Set4 functions to groups of any size, whose outputs
+# don't have to be next to each other. The groups are described in
+# tlc5940-groups.h, and are the same on every chip.
+#  0 = Do not include functions for ganging outputs in groups
+#  1 = Include TLC5940_SetGroupGS() and TLC5940_SetAllGroupsGS() (and
+#      TLC5940_SetGroupDC() and TLC5940_SetAllGroupsDC(), if
+#      TLC5940_INCLUDE_DC_FUNCS = 1)
+TLC5940_INCLUDE_GROUP_FUNCS = 0
+
 # Flag for including a default implementation of the ISR.
 #  0 = For advanced users only! Only choose this if you want to
 #      override the default implementation of the
@@ -86,6 +97,21 @@ TLC5940_INLINE_SETDC_FUNCS = 1
 #      possibly at the expense of program size.
 TLC5940_INLINE_SETGS_FUNCS = 1
 
+# Flag for unrolling the loops that shift grayscale data out of the
+# default ISR, which are generated for the configured TLC5940_N.
+#  0 = One loop iteration per byte; smallest code.
+#  1 = One loop iteration per TLC5940, with all 24 of its bytes
+#      unrolled; about 1 KB of extra code in the ISR.
+#  2 = Fully unrolled, with no loop at all; fastest, but about 1 KB of
+#      code per TLC5940, so it is limited to TLC5940_N <= 16.
+# Either way, each byte is loaded while the previous one is still being
+# shifted out. How much that saves hasn't been measured yet, so
+# TLC5940_TIMING_CHECK assumes the same cost per byte for every setting,
+# and doesn't let a longer chain through for unrolling. "make bench"
+# reports the ISR's cycles per byte, and the largest TLC5940_N that fits,
+# for each setting.
+TLC5940_UNROLL_SHIFT_LOOPS = 0
+
 # Flag to enable multiplexing. This can be used to drive both common
 # cathode (preferred), or common anode RGB LEDs, or even way more
 # single-color LEDs. Use a P-Channel MOSFET such as an IRF9520, or an
@@ -201,6 +227,38 @@ endif
 #  2 = 8-bit Timer/Counter2
 TLC5940_ISR_CTC_TIMER = 0
 
+# Flag for generating the BLANK pulses in hardware, from the output
+# compare pin of the timer selected above, instead of toggling BLANK
+# from inside the ISR. The pulse is exactly one timer count wide, and
+# no longer moves around with the ISR's latency.
+#  0 = BLANK pulsed by the ISR
+#  1 = BLANK driven by OC0B (PD5) for Timer0, or OC2B (PD3) for Timer2
+#
+# Note: ATmega328P only. BLANK_PIN must be set to the matching OC pin,
+#       and XLAT may not be hardwired to BLANK. Since BLANK now stays
+#       high for 64 clock cycles, grayscale values within
+#       64 / TLC5940_GSCLK_DIVIDER of the maximum are fully on. XLAT
+#       must also be pulsed within those 64 clock cycles, so the ISR
+#       can't be held off by TLC5940_ENABLE_TWI_SLAVE, _AUDIO, _SYNC or
+#       _POV, or by long cli() sections in your own code. That it is
+#       hasn't been verified yet: "make blank-trace" records the BLANK
+#       and XLAT edges in simulavr, to check before relying on it.
+TLC5940_HARDWARE_BLANK = 0
+
+# TLC5940_GSCLK_DIVIDER is only defined if TLC5940_HARDWARE_BLANK = 1
+ifeq ($(TLC5940_HARDWARE_BLANK), 1)
+# Divides the CPU clock used for GSCLK:
+#  1 = GSCLK from the CLKO pin, at F_CPU
+#  2 = GSCLK from OC1A (PB1) using Timer1, at F_CPU / 2
+#  4 = GSCLK from OC1A (PB1) using Timer1, at F_CPU / 4
+#
+# Note: Dividing GSCLK makes each PWM cycle (and the interval between
+#       interrupts) that many times longer, which leaves more cycles
+#       for main(), at the cost of a lower refresh rate. Timer1 is
+#       also used by TLC5940_ENABLE_POV, so they can't be combined.
+TLC5940_GSCLK_DIVIDER = 1
+endif
+
 # Determines whether or not GPIOR0 is used to store flags. This
 # special-purpose register is designed to store bit flags, as it can
 # set, clear or test a single bit in only 2 clock cycles. You should
@@ -236,6 +294,470 @@ TLC5940_FLAG_XLAT_NEEDS_PULSE = 1
 endif
 endif
 
+# Flag for including a lock-free queue of grayscale updates. This lets
+# one other interrupt handler (a rotary encoder or serial receiver, for
+# example) request changes to individual channels without touching
+# gsData or pBack directly, and without having to wrap the main loop's
+# frame updates in cli()/sei() critical sections.
+#  0 = Do not include the grayscale update queue
+#  1 = Include TLC5940_QueueGS(), which may be called from exactly one
+#      interrupt handler (the producer), and TLC5940_DrainGSQueue(),
+#      which the main loop (the consumer) calls to apply the queued
+#      updates right before calling TLC5940_SetGSUpdateFlag()
+TLC5940_ENABLE_GS_QUEUE = 0
+
+# TLC5940_GS_QUEUE_SIZE and TLC5940_GS_QUEUE_BATCH are only defined if:
+#     TLC5940_ENABLE_GS_QUEUE = 1
+ifeq ($(TLC5940_ENABLE_GS_QUEUE), 1)
+# Defines the number of updates the queue can hold before
+# TLC5940_QueueGS() starts rejecting them. Must be a power of two
+# between 2 and 128, inclusive, so the 8-bit queue indices can wrap
+# around freely.
+TLC5940_GS_QUEUE_SIZE = 16
+
+# Defines the maximum number of queued updates applied by a single call
+# to TLC5940_DrainGSQueue(), which bounds how long the main loop spends
+# draining the queue before each page-flip. Any updates beyond this are
+# left in the queue for the next frame.
+TLC5940_GS_QUEUE_BATCH = 8
+endif
+
+# Flag for including a queue of timestamped frames, which replaces the
+# TLC5940_SetGSUpdateFlag() mechanism for pacing animations. Instead of
+# drawing a frame and then calling _delay_ms(), the main loop renders
+# frames ahead of time, and tags each one with the tick (counted in CTC
+# interrupts) at which it should appear. The ISR then shows each frame
+# exactly when its tick arrives, so a slow frame no longer shows up as
+# a visible hitch, and the display timing stays locked to BLANK.
+#  0 = Do not include the frame queue
+#  1 = Include the frame queue. Use it like this:
+#
+#      uint16_t tick = TLC5940_GetTicks();
+#      for (;;) {
+#        while (TLC5940_GetFrameQueueFull());
+#        // ... draw the next frame using the Set*GS functions ...
+#        tick += FRAME_TICKS;
+#        TLC5940_QueueFrame(tick);
+#      }
+#
+# Note: The ISR ignores TLC5940_SetGSUpdateFlag() when the frame queue
+#       is enabled. Nothing is displayed until the first frame has been
+#       queued, and when multiplexing, queued frames are only promoted
+#       when the ISR is about to display row 0.
+TLC5940_ENABLE_FRAME_QUEUE = 0
+
+# TLC5940_FRAME_QUEUE_N is only defined if:
+#     TLC5940_ENABLE_FRAME_QUEUE = 1
+ifeq ($(TLC5940_ENABLE_FRAME_QUEUE), 1)
+# Defines the total number of frame buffers, including the one being
+# displayed, so up to (TLC5940_FRAME_QUEUE_N - 1) frames can be queued.
+# Must be between 2 and 8, inclusive. Each buffer uses 24 * TLC5940_N
+# (times TLC5940_MULTIPLEX_N if multiplexing) bytes of RAM.
+TLC5940_FRAME_QUEUE_N = 3
+endif
+
+# Flag for including a crossfade engine, which blends two complete
+# frames, stored in the same packed format as gsData, directly into the
+# back buffer. This is much faster than unpacking each channel, blending
+# it, and writing it back with TLC5940_SetGS().
+#  0 = Do not include the crossfade functions
+#  1 = Include TLC5940_Crossfade(), which blends a whole frame at once,
+#      and TLC5940_CrossfadeBegin()/TLC5940_CrossfadeStep(), which blend
+#      a slice of channels per call so the work can be spread out
+TLC5940_INCLUDE_CROSSFADE = 0
+
+# Flag for including fast fixed-point HSV color functions, which convert
+# a 16-bit hue, an 8-bit saturation, and an 8-bit value into three
+# gamma-corrected grayscale values using only 8x8 hardware multiplies.
+#  0 = Do not include the HSV functions
+#  1 = Include TLC5940_HSVtoGS(), and when multiplexing at least three
+#      rows (red, green, and blue, in that order), TLC5940_SetAllHSV()
+#
+# Note: TLC5940_INCLUDE_HSV = 1 requires TLC5940_INCLUDE_GAMMA_CORRECT = 1
+TLC5940_INCLUDE_HSV = 1
+
+# Flag for enabling layered compositing. A static base frame and a few
+# small overlay layers (a status indicator, or a sparkle effect, for
+# example) are merged into the back buffer using saturating-add, max,
+# or alpha blending. Only the parts of the frame that have changed are
+# recomposited, so the time spent composing each frame depends on the
+# size of the overlays, and not on the number of TLC5940s.
+#  0 = Disable layered compositing
+#  1 = Enable layered compositing. Call TLC5940_SetBaseFrame() and
+#      TLC5940_SetLayer() to set things up, TLC5940_SetLayerGS() to
+#      change the overlays, and TLC5940_Compose() right before each
+#      call to TLC5940_SetGSUpdateFlag().
+#
+# Note: When compositing, the back buffer should only be written to by
+#       TLC5940_Compose(), and not by the Set*GS functions.
+TLC5940_ENABLE_LAYERS = 0
+
+# TLC5940_LAYERS_N is only defined if:
+#     TLC5940_ENABLE_LAYERS = 1
+ifeq ($(TLC5940_ENABLE_LAYERS), 1)
+# Defines the number of overlay layers, between 1 and 8, inclusive.
+# Layers are composited in order, with layer 0 on the bottom.
+TLC5940_LAYERS_N = 2
+endif
+
+# Flag for reading back the status information (SID) of each TLC5940,
+# which contains the LED open detection (LOD) and thermal error flag
+# (TEF) bits. The TLC5940s shift their SID out of SOUT while new
+# grayscale data is being shifted in, so when requested, the ISR simply
+# stores each byte it receives, at almost no extra cost.
+#  0 = Ignore SOUT entirely
+#  1 = Capture the SID during the next grayscale shift after calling
+#      TLC5940_RequestStatus(). Once TLC5940_GetStatusReady() returns
+#      true, TLC5940_GetLOD() and TLC5940_GetTEF() decode the results.
+#
+# Note: Only supported when TLC5940_SPI_MODE = 0, and SOUT of the last
+#       TLC5940 in the chain must be connected to MISO (PB4).
+TLC5940_ENABLE_STATUS_READBACK = 0
+
+# Flag for keeping a running estimate of the current sunk by the
+# TLC5940s (the sum of GS * DC over every channel of a row), which is
+# updated as each channel is written, rather than being recounted every
+# frame. Calling TLC5940_ApplyPowerBudget() right before each page flip
+# scales the whole frame down just enough to keep the busiest row
+# within TLC5940_POWER_BUDGET_MA.
+#  0 = Disable power accounting
+#  1 = Enable power accounting and TLC5940_ApplyPowerBudget()
+#
+# Note: Writing to gsData directly, or calling TLC5940_Crossfade(),
+#       TLC5940_SetAllHSV() or TLC5940_SetAllGroupsGS(), makes the next
+#       check recount the frame.
+#       Frames are scaled in place, so each one must be redrawn in full,
+#       and TLC5940_ENABLE_LAYERS = 1 or TLC5940_ENABLE_GS_QUEUE = 1
+#       (which only redraw what changed) require
+#       TLC5940_ENABLE_MASTER_BRIGHTNESS = 1.
+TLC5940_ENABLE_POWER_GOVERNOR = 0
+
+# TLC5940_POWER_BUDGET_MA and TLC5940_R_IREF are only defined if:
+#     TLC5940_ENABLE_POWER_GOVERNOR = 1
+ifeq ($(TLC5940_ENABLE_POWER_GOVERNOR), 1)
+# The most current (in mA) that any one row may sink from the supply,
+# summed over every channel of every TLC5940 in the chain.
+TLC5940_POWER_BUDGET_MA = 2000
+
+# The value (in ohms) of the resistor from IREF to GND, which sets the
+# maximum current of each channel to 39.06 V / TLC5940_R_IREF.
+TLC5940_R_IREF = 2000
+endif
+
+# Flag for checking, at compile time, that the default ISR can shift
+# out 24 * TLC5940_N bytes before the next interrupt is due, using an
+# estimated cycle count for the chosen TLC5940_SPI_MODE. If it can't,
+# the ISR would delay the next BLANK pulse, which shows up as flicker,
+# and the figures that went into the estimate are reported.
+#  0 = Skip the check
+#  1 = Report when the ISR overruns the interrupt interval
+#  2 = Fail the build when the ISR overruns the interrupt interval
+#
+# Note: The cycle counts haven't been measured yet (see "make bench"),
+#       so the default only reports an overrun, as a message that
+#       -Werror leaves alone. When TLC5940_ENABLE_MULTIPLEXING = 0, the
+#       ISR only shifts data out after TLC5940_SetGSUpdateFlag() is
+#       called, so an overrun only glitches the frames that change.
+TLC5940_TIMING_CHECK = 1
+
+# Flag for synchronizing the display to the rotation of a persistence
+# of vision display. An index pulse from a hall sensor (or similar) on
+# ICP1 is timestamped by Timer1's input capture unit, the period of the
+# next revolution is predicted from the last few, and each column is
+# queued with TLC5940_QueueFrame() to be shown at the tick nearest to
+# its angle.
+#  0 = Disable the column scheduler
+#  1 = Enable the column scheduler. While TLC5940_POV_GetSpinning()
+#      returns true, and the frame queue isn't full, render the column
+#      returned by TLC5940_POV_NextColumn() into the back buffer, and
+#      then call TLC5940_POV_QueueColumn().
+#
+# Note: TLC5940_ENABLE_POV = 1 requires TLC5940_ENABLE_FRAME_QUEUE = 1,
+#       an AVR with a 16-bit Timer1 with input capture, and Timer1
+#       can't be used for anything else.
+TLC5940_ENABLE_POV = 0
+
+# TLC5940_POV_COLUMNS, TLC5940_POV_HISTORY, and TLC5940_POV_INDEX_EDGE
+# are only defined if:
+#     TLC5940_ENABLE_POV = 1
+ifeq ($(TLC5940_ENABLE_POV), 1)
+# The number of columns per revolution, between 1 and 255, inclusive
+TLC5940_POV_COLUMNS = 120
+
+# The number of revolutions (2, 4, or 8) used to predict the next one.
+# More revolutions average out more sensor noise, but it takes longer
+# for a change in speed to be followed.
+TLC5940_POV_HISTORY = 4
+
+# Which edge of ICP1 marks the index
+#  0 = Falling edge (e.g. an open-drain hall sensor with a pull-up)
+#  1 = Rising edge
+TLC5940_POV_INDEX_EDGE = 0
+endif
+
+# Flag for including TLC5940_ClockInBootFrame(), which shifts a frame
+# (and optionally a DC profile) stored in PROGMEM straight into the
+# TLC5940s as the very first data they latch, in place of the zeroes
+# shifted in by TLC5940_ClockInGS(). A boot logo is then lit as soon as
+# TLC5940_Init() and TLC5940_ClockInBootFrame() return, without waiting
+# for main() to render a first frame or for the first interrupt.
+#  0 = Do not include TLC5940_ClockInBootFrame()
+#  1 = Include TLC5940_ClockInBootFrame()
+#
+# Note: Most of the time between reset and the first frame is usually
+#       spent in the start-up delay selected by the SUT fuses, and
+#       clearing .bss, rather than in shifting out the frame.
+TLC5940_INCLUDE_BOOT_FRAME = 0
+
+# Flag for per-unit calibration stored in the AVR's EEPROM, so the same
+# firmware can be flashed onto every panel. TLC5940_LoadCalibration()
+# reads a versioned blob of per-channel DC values and per-channel 8-bit
+# gains once at boot, and TLC5940_ApplyCalibration() scales the whole
+# back buffer by the gains in one pass right before each page flip.
+#  0 = Disable calibration
+#  1 = Enable TLC5940_LoadCalibration() and TLC5940_ApplyCalibration()
+#
+# Note: The gain table takes 16 * TLC5940_N * TLC5940_MULTIPLEX_N bytes
+#       of RAM, and the DC values are only applied if
+#       TLC5940_INCLUDE_DC_FUNCS = 1. Frames are scaled in place, so each
+#       one must be redrawn in full, and TLC5940_ENABLE_LAYERS = 1 or
+#       TLC5940_ENABLE_GS_QUEUE = 1 (which only redraw what changed)
+#       require TLC5940_ENABLE_MASTER_BRIGHTNESS = 1.
+TLC5940_ENABLE_CALIBRATION = 0
+
+# TLC5940_CALIBRATION_ADDRESS is only defined if:
+#     TLC5940_ENABLE_CALIBRATION = 1
+ifeq ($(TLC5940_ENABLE_CALIBRATION), 1)
+# The EEPROM address that the calibration blob starts at
+TLC5940_CALIBRATION_ADDRESS = 0
+endif
+
+# Flag for including a color correction kernel for multiplexed red,
+# green, and blue rows. TLC5940_SetAllRGB() passes every 8-bit RGB
+# pixel through a 3x3 fixed-point matrix (TLC5940_colorMatrix, which can
+# be changed at run time to suit each install's LEDs), clamps it, gamma
+# corrects it, and writes rows 0, 1 and 2 of the back buffer in one pass.
+#  0 = Do not include the color matrix functions
+#  1 = Include TLC5940_SetAllRGB()
+#
+# Note: TLC5940_INCLUDE_COLOR_MATRIX = 1 requires
+#       TLC5940_INCLUDE_GAMMA_CORRECT = 1, and multiplexing at least three
+#       rows (red, green, and blue, in that order).
+TLC5940_INCLUDE_COLOR_MATRIX = 0
+
+# Flag for receiving frames from a master MCU over TWI (I2C), so that one
+# master can feed several controllers over a shared two-wire bus. Data
+# written to TLC5940_TWI_ADDRESS is streamed straight into the back
+# buffer at the offset given by its first byte(s), and writing the
+# TLC5940_TWI_COMMIT byte to the general call address (0x00) commits the
+# back buffer on every slave at the same moment.
+#  0 = Disable the TWI slave
+#  1 = Enable the TWI slave, along with its ISR(TWI_vect)
+#
+# Note: This uses the TWI module's pins (PC4/SDA and PC5/SCL on the
+#       ATmega328P), so they can't be used as row pins. The ATtiny85 has
+#       no TWI module, so this can't be used with TLC5940_SPI_MODE = 2.
+TLC5940_ENABLE_TWI_SLAVE = 0
+
+# TLC5940_TWI_ADDRESS and TLC5940_TWI_COMMIT are only defined if:
+#     TLC5940_ENABLE_TWI_SLAVE = 1
+ifeq ($(TLC5940_ENABLE_TWI_SLAVE), 1)
+# This controller's 7-bit TWI address (0x08 through 0x77)
+TLC5940_TWI_ADDRESS = 0x40
+# The command byte that commits the back buffer when it is written to
+# the general call address. Any other general call, such as the 0x06
+# reset from the I2C specification, is ignored. It must be even, and not
+# one of the codes the specification reserves (0x00, 0x04 or 0x06).
+TLC5940_TWI_COMMIT = 0x5A
+endif
+
+# Flag for an audio-reactive pipeline. The ADC samples an audio input in
+# free-running mode into one of two blocks while the main loop works on
+# the other, and TLC5940_Audio_Process() runs a fixed-point FFT on each
+# full block in the time between CTC interrupts, reducing it to
+# TLC5940_AUDIO_BANDS_N (8) band levels ready to be used as grayscale
+# values, or spread across the channels with TLC5940_Audio_SetBands().
+#  0 = Disable the audio pipeline
+#  1 = Enable the audio pipeline, along with its ISR(ADC_vect)
+#
+# Note: This is only supported on the ATmega328P, and the ADC can't be
+#       used for anything else. If TLC5940_TIMING_CHECK is enabled, the
+#       estimated cost of each block is also checked against the time
+#       left over by the ISR.
+TLC5940_ENABLE_AUDIO = 0
+
+# TLC5940_AUDIO_FFT_N, TLC5940_AUDIO_ADC_CHANNEL, and
+# TLC5940_AUDIO_ADC_PRESCALER are only defined if:
+#     TLC5940_ENABLE_AUDIO = 1
+ifeq ($(TLC5940_ENABLE_AUDIO), 1)
+# Number of samples per FFT block: 64 or 128. A block uses 6 bytes of
+# RAM per sample.
+TLC5940_AUDIO_FFT_N = 128
+
+# ADC input pin (0 through 7) that the audio signal, biased at about half
+# of AVcc, is connected to
+TLC5940_AUDIO_ADC_CHANNEL = 7
+
+# ADC clock divider: 32, 64, or 128. Each sample takes 13 ADC clocks, so
+# at 16 MHz, 128 samples at about 9.6 kHz (a 4.8 kHz bandwidth).
+TLC5940_AUDIO_ADC_PRESCALER = 128
+endif
+
+# Flag for a cooperative effect scheduler. Each effect is registered in
+# a priority slot with a declared budget, and TLC5940_RunTasks() runs
+# them in priority order once per frame, deferring any that won't fit
+# before the frame's deadline to the next frame, so that a slow effect
+# can't make every frame late. Run time is measured with the CTC timer
+# and kept per task.
+#  0 = Disable the scheduler
+#  1 = Enable TLC5940_SetTask(), TLC5940_RunTasks(), and TLC5940_GetTime()
+#
+# Note: This makes the ISR count ticks, as with TLC5940_ENABLE_FRAME_QUEUE.
+TLC5940_ENABLE_SCHEDULER = 0
+
+# TLC5940_TASKS_N is only defined if:
+#     TLC5940_ENABLE_SCHEDULER = 1
+ifeq ($(TLC5940_ENABLE_SCHEDULER), 1)
+# Number of task slots, between 1 and 16, inclusive. Each one uses 18
+# bytes of RAM.
+TLC5940_TASKS_N = 8
+endif
+
+# Flag for tiling several controllers into one display without tearing
+# across the seams. One board, the leader, pulses a shared sync line on
+# INT0 (PD2) one interrupt ahead of each page flip, and every other
+# board, a follower, flips on that same interrupt, after lining up its
+# row (when multiplexing) and optionally its CTC timer with the leader's.
+#  0 = Disable frame synchronization
+#  1 = Enable frame synchronization, along with ISR(INT0_vect) on
+#      followers
+#
+# Note: This is only supported on the ATmega328P, and requires
+#       TLC5940_INCLUDE_DEFAULT_ISR = 1 and TLC5940_ENABLE_FRAME_QUEUE = 0.
+#       Every board must use the same TLC5940_MULTIPLEX_N and
+#       TLC5940_PWM_BITS (or TLC5940_CTC_TOP).
+TLC5940_ENABLE_SYNC = 0
+
+# TLC5940_SYNC_LEADER and TLC5940_SYNC_PHASE are only defined if:
+#     TLC5940_ENABLE_SYNC = 1
+ifeq ($(TLC5940_ENABLE_SYNC), 1)
+# 1 = This board drives the sync line, 0 = this board follows it. Exactly
+# one board on the line must be the leader.
+TLC5940_SYNC_LEADER = 1
+
+# Only used by followers:
+#  0 = Only line up the page flips (and rows), leaving the BLANK pulses
+#      to drift apart by up to one interrupt
+#  1 = Also restart the CTC timer on each sync pulse, keeping the BLANK
+#      pulses of every board within about one count of the leader's
+TLC5940_SYNC_PHASE = 1
+endif
+
+# Flag for recording what the library does to the outputs into a small
+# ring buffer in RAM, to find out the order of events behind a glitch.
+# Each event is stored as the low byte of the CTC interrupt count and an
+# event code, at a cost of about 12 clock cycles. TLC5940_TraceDump()
+# sends the ring out through a function of your choosing (a USART, for
+# example), and the tlc5940-trace tool (make tlc5940-trace) turns that
+# into a timeline and a histogram of update to latch latencies on a PC.
+#  0 = Disable tracing
+#  1 = Record TLC5940_SetGSUpdateFlag() and TLC5940_QueueFrame() calls,
+#      page flips, and XLAT pulses that latch a new frame
+#  2 = Also record every BLANK pulse, along with the row it lights when
+#      multiplexing. This fills the ring in TLC5940_TRACE_N interrupts.
+#
+# Note: This requires TLC5940_INCLUDE_DEFAULT_ISR = 1
+TLC5940_ENABLE_TRACE = 0
+
+# TLC5940_TRACE_N is only defined if:
+#     TLC5940_ENABLE_TRACE = 1 or 2
+ifneq ($(TLC5940_ENABLE_TRACE), 0)
+# Number of events kept: 8, 16, 32, 64, or 128. Each one uses 2 bytes of
+# RAM.
+TLC5940_TRACE_N = 32
+endif
+
+# Flag for generating the grayscale data on the fly instead of storing
+# it, which saves the 24 * TLC5940_N bytes of RAM used by gsData. Every
+# time the default ISR shifts out new data (after
+# TLC5940_SetGSUpdateFlag() is called), it gets the value of each output
+# from the inline function TLC5940_Render() in tlc5940-render.h, which
+# can compute a pattern or read it from flash.
+#  0 = Disable rendering, and use gsData and the Set*GS functions
+#  1 = Enable rendering. The Set*GS functions are not available.
+#
+# Note: This requires TLC5940_ENABLE_MULTIPLEXING = 0,
+#       TLC5940_INCLUDE_DC_FUNCS = 0, and TLC5940_INCLUDE_DEFAULT_ISR = 1,
+#       and can't be used with any option that reads or writes the
+#       grayscale buffer.
+TLC5940_ENABLE_RENDER = 0
+
+# TLC5940_RENDER_CYCLES is only defined if:
+#     TLC5940_ENABLE_RENDER = 1
+ifeq ($(TLC5940_ENABLE_RENDER), 1)
+# Rough number of clock cycles that one call to TLC5940_Render() takes.
+# The ISR spends about (2 * TLC5940_RENDER_CYCLES + 14) / 3 clocks per
+# byte on rendering, on top of shifting the byte out, which is included
+# in TLC5940_TIMING_CHECK.
+TLC5940_RENDER_CYCLES = 20
+endif
+
+# Flag for a master brightness that dims the whole display without the
+# application ever rescaling its own data. TLC5940_SetMasterBrightness()
+# sets a level from 0 to 255 (and TLC5940_SetRowBrightness() an extra one
+# per row when multiplexing). The Set*GS functions then draw into a frame
+# of their own that is never scaled, and TLC5940_ApplyMasterBrightness()
+# writes it, scaled, into the back buffer in one pass right before each
+# page flip.
+#  0 = Disable the master brightness
+#  1 = Enable TLC5940_SetMasterBrightness() and friends
+#
+# Note: Unlike TLC5940_SetAllDC(), this gives 256 even steps, and it
+#       works with any content. Each pass is estimated, not measured,
+#       to cost about 640 * TLC5940_N clock cycles per row, unless the
+#       row is at 255 ("make bench" reports the cost per TLC5940 for
+#       TLC5940_N = 1 to 16). The unscaled frame takes another
+#       24 * TLC5940_N bytes of RAM per row. It can't be used with
+#       TLC5940_ENABLE_TWI_SLAVE = 1.
+TLC5940_ENABLE_MASTER_BRIGHTNESS = 0
+
+# Flag for switching the PWM resolution (and with it, the refresh rate)
+# at run time, for example 12 bits for slow ambient scenes and 9 or 10
+# bits, with four or eight times as many BLANK pulses, for fast content
+# or anything in front of a camera. TLC5940_SetPWMBits() rescales the
+# back buffer, and the ISR changes the interrupt interval on the same
+# interrupt that latches it. TLC5940_PWM_BITS is the resolution at boot,
+# and the highest one that can be switched to.
+#  0 = Disable run-time switching
+#  1 = Enable TLC5940_SetPWMBits() and TLC5940_GetPWMBits()
+#
+# Note: Only works with TLC5940_PWM_BITS set to 8 - 12, and not with
+#       TLC5940_ENABLE_FRAME_QUEUE, or anything else that assumes a fixed
+#       interrupt interval (see tlc5940.h).
+TLC5940_ENABLE_PWM_SWITCHING = 0
+
+# TLC5940_PWM_BITS_MIN is only defined if:
+#     TLC5940_ENABLE_PWM_SWITCHING = 1
+ifeq ($(TLC5940_ENABLE_PWM_SWITCHING), 1)
+# The lowest resolution that TLC5940_SetPWMBits() will be asked for,
+# which TLC5940_TIMING_CHECK uses as the shortest interrupt interval
+TLC5940_PWM_BITS_MIN = 10
+endif
+
+# Flag for treating a multiplexed display as a 2D matrix of pixels, with
+# x as the channel and y as the row, for scrolling signs and the like.
+# The ISR reads the rows of each frame through a table of row numbers,
+# so TLC5940_Matrix_ScrollUp() and TLC5940_Matrix_ScrollDown() only
+# rotate that table, instead of rewriting every pixel, and
+# TLC5940_Matrix_ScrollLeft() and TLC5940_Matrix_ScrollRight() move
+# whole TLC5940s at a time with block moves.
+#  0 = Disable the matrix functions
+#  1 = Enable TLC5940_Matrix_SetPixel() and the scroll functions
+#
+# Note: This requires TLC5940_ENABLE_MULTIPLEXING = 1, and can't be used
+#       with TLC5940_ENABLE_FRAME_QUEUE = 1.
+TLC5940_ENABLE_MATRIX = 0
+
 # When BLANK is high, all outputs of the TLC5940 chip(s) will be
 # disabled, and when BLANK is low, all outputs will be enabled. There
 # must be an external 10K pull-up resistor attached to this pin. Choose
@@ -394,6 +916,9 @@ endif
 ifeq ($(TLC5940_XLAT_AND_BLANK_HARDWIRED_TOGETHER), 1)
 TLC5940_BLANK_AND_XLAT_SHARE_PORT = 1
 endif
+ifeq ($(TLC5940_HARDWARE_BLANK), 1)
+TLC5940_BLANK_AND_XLAT_SHARE_PORT = 0
+endif
 ifeq ($(TLC5940_ENABLE_MULTIPLEXING), 1)
 ifeq ($(MULTIPLEX_INPUT), $(XLAT_INPUT))
 TLC5940_MULTIPLEX_AND_XLAT_SHARE_PORT = 1
@@ -459,6 +984,7 @@ TLC5940_MULTIPLEXING_DEFINES = -DTLC5940_MULTIPLEX_N=$(TLC5940_MULTIPLEX_N) \
 endif
 
 ifeq ($(TLC5940_SPI_MODE), 0)
+ifneq ($(TLC5940_ENABLE_STATUS_READBACK), 1)
 $(warning @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@ PB4 WARNING @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@)
 $(warning @ The pin PB4 will automatically be set as an input pin by the Master)
 $(warning @ SPI hardware, because TLC5940_SPI_MODE = 0.)
@@ -468,8 +994,10 @@ $(warning @ should be able to use PB4 as an input for something else in your)
 $(warning @ application, because the library does not actually receive data on this)
 $(warning @ pin.)
 $(warning @)
-$(warning @ This warning will remain as long as TLC5940_SPI_MODE = 0.)
+$(warning @ This warning will remain as long as TLC5940_SPI_MODE = 0, unless)
+$(warning @ TLC5940_ENABLE_STATUS_READBACK = 1, in which case PB4 is used as MISO.)
 $(warning @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@ PB4 WARNING @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@)
+endif
 ifneq ($(BLANK_PIN), PB2)
 ifneq ($(XLAT_PIN), PB2)
 ifneq ($(DCPRG_PIN), PB2)
@@ -541,6 +1069,84 @@ ifeq ($(TLC5940_PB2_UNMAPPED), 1)
 TLC5940_PB2_UNMAPPED_DEFINE = -DTLC5940_PB2_UNMAPPED=$(TLC5940_PB2_UNMAPPED)
 endif
 
+# This avoids adding needless defines if TLC5940_ENABLE_GS_QUEUE = 0
+ifeq ($(TLC5940_ENABLE_GS_QUEUE), 1)
+TLC5940_GS_QUEUE_DEFINES = -DTLC5940_GS_QUEUE_SIZE=$(TLC5940_GS_QUEUE_SIZE) \
+                           -DTLC5940_GS_QUEUE_BATCH=$(TLC5940_GS_QUEUE_BATCH)
+endif
+
+# This avoids adding a needless define if TLC5940_ENABLE_FRAME_QUEUE = 0
+ifeq ($(TLC5940_ENABLE_FRAME_QUEUE), 1)
+TLC5940_FRAME_QUEUE_DEFINES = -DTLC5940_FRAME_QUEUE_N=$(TLC5940_FRAME_QUEUE_N)
+endif
+
+# This avoids adding a needless define if TLC5940_ENABLE_LAYERS = 0
+ifeq ($(TLC5940_ENABLE_LAYERS), 1)
+TLC5940_LAYERS_DEFINES = -DTLC5940_LAYERS_N=$(TLC5940_LAYERS_N)
+endif
+
+# This avoids adding needless defines if TLC5940_ENABLE_POWER_GOVERNOR = 0
+ifeq ($(TLC5940_ENABLE_POWER_GOVERNOR), 1)
+TLC5940_POWER_GOVERNOR_DEFINES = -DTLC5940_POWER_BUDGET_MA=$(TLC5940_POWER_BUDGET_MA) \
+                                 -DTLC5940_R_IREF=$(TLC5940_R_IREF)
+endif
+
+# This avoids adding needless defines if TLC5940_ENABLE_POV = 0
+ifeq ($(TLC5940_ENABLE_POV), 1)
+TLC5940_POV_DEFINES = -DTLC5940_POV_COLUMNS=$(TLC5940_POV_COLUMNS) \
+                      -DTLC5940_POV_HISTORY=$(TLC5940_POV_HISTORY) \
+                      -DTLC5940_POV_INDEX_EDGE=$(TLC5940_POV_INDEX_EDGE)
+endif
+
+# This avoids adding needless defines if TLC5940_ENABLE_CALIBRATION = 0
+ifeq ($(TLC5940_ENABLE_CALIBRATION), 1)
+TLC5940_CALIBRATION_DEFINES = -DTLC5940_CALIBRATION_ADDRESS=$(TLC5940_CALIBRATION_ADDRESS)
+endif
+
+# This avoids adding needless defines if TLC5940_ENABLE_TWI_SLAVE = 0
+ifeq ($(TLC5940_ENABLE_TWI_SLAVE), 1)
+TLC5940_TWI_SLAVE_DEFINES = -DTLC5940_TWI_ADDRESS=$(TLC5940_TWI_ADDRESS) \
+                            -DTLC5940_TWI_COMMIT=$(TLC5940_TWI_COMMIT)
+endif
+
+# This avoids adding needless defines if TLC5940_ENABLE_AUDIO = 0
+ifeq ($(TLC5940_ENABLE_AUDIO), 1)
+TLC5940_AUDIO_DEFINES = -DTLC5940_AUDIO_FFT_N=$(TLC5940_AUDIO_FFT_N) \
+                        -DTLC5940_AUDIO_ADC_CHANNEL=$(TLC5940_AUDIO_ADC_CHANNEL) \
+                        -DTLC5940_AUDIO_ADC_PRESCALER=$(TLC5940_AUDIO_ADC_PRESCALER)
+endif
+
+# This avoids adding needless defines if TLC5940_ENABLE_SCHEDULER = 0
+ifeq ($(TLC5940_ENABLE_SCHEDULER), 1)
+TLC5940_SCHEDULER_DEFINES = -DTLC5940_TASKS_N=$(TLC5940_TASKS_N)
+endif
+
+# This avoids adding needless defines if TLC5940_ENABLE_SYNC = 0
+ifeq ($(TLC5940_ENABLE_SYNC), 1)
+TLC5940_SYNC_DEFINES = -DTLC5940_SYNC_LEADER=$(TLC5940_SYNC_LEADER) \
+                       -DTLC5940_SYNC_PHASE=$(TLC5940_SYNC_PHASE)
+endif
+
+# This avoids adding needless defines if TLC5940_ENABLE_TRACE = 0
+ifneq ($(TLC5940_ENABLE_TRACE), 0)
+TLC5940_TRACE_DEFINES = -DTLC5940_TRACE_N=$(TLC5940_TRACE_N)
+endif
+
+# This avoids adding needless defines if TLC5940_ENABLE_RENDER = 0
+ifeq ($(TLC5940_ENABLE_RENDER), 1)
+TLC5940_RENDER_DEFINES = -DTLC5940_RENDER_CYCLES=$(TLC5940_RENDER_CYCLES)
+endif
+
+# This avoids adding needless defines if TLC5940_HARDWARE_BLANK = 0
+ifeq ($(TLC5940_HARDWARE_BLANK), 1)
+TLC5940_HARDWARE_BLANK_DEFINES = -DTLC5940_GSCLK_DIVIDER=$(TLC5940_GSCLK_DIVIDER)
+endif
+
+# This avoids adding needless defines if TLC5940_ENABLE_PWM_SWITCHING = 0
+ifeq ($(TLC5940_ENABLE_PWM_SWITCHING), 1)
+TLC5940_PWM_SWITCHING_DEFINES = -DTLC5940_PWM_BITS_MIN=$(TLC5940_PWM_BITS_MIN)
+endif
+
 # This line integrates all options into a single flag called:
 #     $(TLC5940_DEFINES)
 # which should be appended to the definition of COMPILE in the Makefile
@@ -550,10 +1156,12 @@ TLC5940_DEFINES = -D__DELAY_BACKWARD_COMPATIBLE__ \
                   -DTLC5940_VPRG_DCPRG_HARDWIRED_TO_GND=$(TLC5940_VPRG_DCPRG_HARDWIRED_TO_GND) \
                   -DTLC5940_DCPRG_HARDWIRED_TO_VCC=$(TLC5940_DCPRG_HARDWIRED_TO_VCC) \
                   -DTLC5940_INCLUDE_SET4_FUNCS=$(TLC5940_INCLUDE_SET4_FUNCS) \
+                  -DTLC5940_INCLUDE_GROUP_FUNCS=$(TLC5940_INCLUDE_GROUP_FUNCS) \
                   -DTLC5940_INCLUDE_DEFAULT_ISR=$(TLC5940_INCLUDE_DEFAULT_ISR) \
                   -DTLC5940_INCLUDE_GAMMA_CORRECT=$(TLC5940_INCLUDE_GAMMA_CORRECT) \
                   $(TLC5940_INLINE_SETDC_FUNCS_DEFINE) \
                   -DTLC5940_INLINE_SETGS_FUNCS=$(TLC5940_INLINE_SETGS_FUNCS) \
+                  -DTLC5940_UNROLL_SHIFT_LOOPS=$(TLC5940_UNROLL_SHIFT_LOOPS) \
                   -DTLC5940_ENABLE_MULTIPLEXING=$(TLC5940_ENABLE_MULTIPLEXING) \
                   -DTLC5940_MULTIPLEX_AND_XLAT_SHARE_PORT=$(TLC5940_MULTIPLEX_AND_XLAT_SHARE_PORT) \
                   $(TLC5940_MULTIPLEXING_DEFINES) \
@@ -571,5 +1179,41 @@ TLC5940_DEFINES = -D__DELAY_BACKWARD_COMPATIBLE__ \
                   -DXLAT_PIN=$(XLAT_PIN) \
                   -DTLC5940_BLANK_AND_XLAT_SHARE_PORT=$(TLC5940_BLANK_AND_XLAT_SHARE_PORT) \
                   -DTLC5940_XLAT_AND_BLANK_HARDWIRED_TOGETHER=$(TLC5940_XLAT_AND_BLANK_HARDWIRED_TOGETHER) \
+                  -DTLC5940_ENABLE_GS_QUEUE=$(TLC5940_ENABLE_GS_QUEUE) \
+                  $(TLC5940_GS_QUEUE_DEFINES) \
+                  -DTLC5940_ENABLE_FRAME_QUEUE=$(TLC5940_ENABLE_FRAME_QUEUE) \
+                  $(TLC5940_FRAME_QUEUE_DEFINES) \
+                  -DTLC5940_INCLUDE_CROSSFADE=$(TLC5940_INCLUDE_CROSSFADE) \
+                  -DTLC5940_INCLUDE_HSV=$(TLC5940_INCLUDE_HSV) \
+                  -DTLC5940_ENABLE_LAYERS=$(TLC5940_ENABLE_LAYERS) \
+                  $(TLC5940_LAYERS_DEFINES) \
+                  -DTLC5940_ENABLE_STATUS_READBACK=$(TLC5940_ENABLE_STATUS_READBACK) \
+                  -DTLC5940_ENABLE_POWER_GOVERNOR=$(TLC5940_ENABLE_POWER_GOVERNOR) \
+                  $(TLC5940_POWER_GOVERNOR_DEFINES) \
+                  -DTLC5940_TIMING_CHECK=$(TLC5940_TIMING_CHECK) \
+                  -DTLC5940_ENABLE_POV=$(TLC5940_ENABLE_POV) \
+                  $(TLC5940_POV_DEFINES) \
+                  -DTLC5940_INCLUDE_BOOT_FRAME=$(TLC5940_INCLUDE_BOOT_FRAME) \
+                  -DTLC5940_ENABLE_CALIBRATION=$(TLC5940_ENABLE_CALIBRATION) \
+                  $(TLC5940_CALIBRATION_DEFINES) \
+                  -DTLC5940_INCLUDE_COLOR_MATRIX=$(TLC5940_INCLUDE_COLOR_MATRIX) \
+                  -DTLC5940_ENABLE_TWI_SLAVE=$(TLC5940_ENABLE_TWI_SLAVE) \
+                  $(TLC5940_TWI_SLAVE_DEFINES) \
+                  -DTLC5940_ENABLE_AUDIO=$(TLC5940_ENABLE_AUDIO) \
+                  $(TLC5940_AUDIO_DEFINES) \
+                  -DTLC5940_ENABLE_SCHEDULER=$(TLC5940_ENABLE_SCHEDULER) \
+                  $(TLC5940_SCHEDULER_DEFINES) \
+                  -DTLC5940_ENABLE_SYNC=$(TLC5940_ENABLE_SYNC) \
+                  $(TLC5940_SYNC_DEFINES) \
+                  -DTLC5940_ENABLE_TRACE=$(TLC5940_ENABLE_TRACE) \
+                  $(TLC5940_TRACE_DEFINES) \
+                  -DTLC5940_ENABLE_RENDER=$(TLC5940_ENABLE_RENDER) \
+                  $(TLC5940_RENDER_DEFINES) \
+                  -DTLC5940_HARDWARE_BLANK=$(TLC5940_HARDWARE_BLANK) \
+                  $(TLC5940_HARDWARE_BLANK_DEFINES) \
+                  -DTLC5940_ENABLE_MASTER_BRIGHTNESS=$(TLC5940_ENABLE_MASTER_BRIGHTNESS) \
+                  -DTLC5940_ENABLE_PWM_SWITCHING=$(TLC5940_ENABLE_PWM_SWITCHING) \
+                  $(TLC5940_PWM_SWITCHING_DEFINES) \
+                  -DTLC5940_ENABLE_MATRIX=$(TLC5940_ENABLE_MATRIX) \
                   $(TLC5940_PB2_UNMAPPED_DEFINE) \
                   $(TLC5940_BACKWARDS_COMPATIBLE_DEFINES)
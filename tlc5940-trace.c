@@ -0,0 +1,223 @@
+/*
+
+  tlc5940-trace.c
+
+  Copyright 2015 Matthew T. Pandina. All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY MATTHEW T. PANDINA "AS IS" AND ANY
+  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHEW T. PANDINA OR
+  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+  USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+  SUCH DAMAGE.
+
+  --------------------------------------------------------------------
+
+  Decodes the output of TLC5940_TraceDump() on a PC. Build it with
+  "make tlc5940-trace", capture the dump (from a serial port, for
+  example) into a file, and run:
+
+    tlc5940-trace [-f F_CPU] [file]
+
+  It prints every event with its time since the oldest one, followed by
+  histograms of how many interrupts it took for each
+  TLC5940_SetGSUpdateFlag() (or TLC5940_QueueFrame()) to be taken by the
+  ISR, and to be latched onto the outputs.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// These must match the event codes in tlc5940.h
+#define TLC5940_TRACE_NONE 0x00
+#define TLC5940_TRACE_WRAP 0x10
+#define TLC5940_TRACE_BLANK 0x20
+#define TLC5940_TRACE_XLAT 0x30
+#define TLC5940_TRACE_FLIP 0x40
+#define TLC5940_TRACE_SET 0x50
+#define TLC5940_TRACE_USER 0xF0
+
+#define HISTOGRAM_N 16
+
+typedef struct {
+  long tick;
+  int event;
+} Event;
+
+static void PrintHistogram(const char *title, const long *histogram, long count) {
+  long most = 1;
+  for (int i = 0; i <= HISTOGRAM_N; i++)
+    if (histogram[i] > most)
+      most = histogram[i];
+
+  printf("\n%s (%ld samples, in interrupts):\n", title, count);
+  for (int i = 0; i <= HISTOGRAM_N; i++) {
+    if (i == HISTOGRAM_N)
+      printf("  >=%2d %5ld ", HISTOGRAM_N, histogram[i]);
+    else
+      printf("  %4d %5ld ", i, histogram[i]);
+    for (long j = 0; j < (histogram[i] * 50 + most - 1) / most; j++)
+      putchar('#');
+    putchar('\n');
+  }
+}
+
+int main(int argc, char *argv[]) {
+  double fcpu = 16000000.0;
+  const char *path = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+      fcpu = atof(argv[++i]);
+    else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+      fprintf(stderr, "usage: %s [-f F_CPU] [file]\n", argv[0]);
+      return 2;
+    } else
+      path = argv[i];
+  }
+
+  FILE *in = (path && strcmp(path, "-") != 0) ? fopen(path, "rb") : stdin;
+  if (!in) {
+    perror(path);
+    return 1;
+  }
+
+  // Skip anything sent before the dump, such as a boot message
+  int c, last = EOF;
+  while ((c = fgetc(in)) != EOF) {
+    if (last == 'T' && c == 'R')
+      break;
+    last = c;
+  }
+  int n = fgetc(in);
+  int top = fgetc(in);
+  int rows = fgetc(in);
+  if (c == EOF || n == EOF || top == EOF || rows == EOF) {
+    fprintf(stderr, "no trace found\n");
+    return 1;
+  }
+
+  // Entries only hold the low byte of the tick, so the full tick is
+  // rebuilt from the wrap events that the ISR records
+  Event *events = calloc(n, sizeof(Event));
+  int count = 0;
+  long epoch = 0;
+  int lastTick = -1;
+  for (int i = 0; i < n; i++) {
+    int tick = fgetc(in);
+    int event = fgetc(in);
+    if (tick == EOF || event == EOF) {
+      fprintf(stderr, "trace cut short after %d of %d entries\n", i, n);
+      break;
+    }
+    if (event == TLC5940_TRACE_NONE)
+      continue;
+    // A wrap can only be missing if it happened while the ring was frozen
+    if (event == TLC5940_TRACE_WRAP || (lastTick >= 0 && tick < lastTick))
+      epoch++;
+    lastTick = tick;
+    events[count].tick = epoch * 256 + tick;
+    events[count].event = event;
+    count++;
+  }
+  if (in != stdin)
+    fclose(in);
+
+  double tickUs = (top + 1) * 64 * 1000000.0 / fcpu;
+  printf("%d events, %.1f us per interrupt", count, tickUs);
+  if (rows)
+    printf(", %d rows", rows);
+  printf("\n\n   tick       ms  event\n");
+
+  for (int i = 0; i < count; i++) {
+    long tick = events[i].tick - events[0].tick;
+    int arg = events[i].event & 0x0F;
+    printf("%7ld %8.3f  ", tick, tick * tickUs / 1000.0);
+    switch (events[i].event & 0xF0) {
+    case TLC5940_TRACE_WRAP:
+      printf("-\n");
+      break;
+    case TLC5940_TRACE_BLANK:
+      if (rows)
+        printf("BLANK  row %d\n", arg);
+      else
+        printf("BLANK\n");
+      break;
+    case TLC5940_TRACE_XLAT:
+      if (rows)
+        printf("XLAT   new frame, row %d\n", arg);
+      else
+        printf("XLAT   new frame\n");
+      break;
+    case TLC5940_TRACE_FLIP:
+      printf("FLIP%s\n", arg ? "   from the frame queue" : "");
+      break;
+    case TLC5940_TRACE_SET:
+      printf("%s\n", arg ? "QUEUE" : "SET");
+      break;
+    case TLC5940_TRACE_USER:
+      printf("USER   %d\n", arg);
+      break;
+    default:
+      printf("?      0x%02X\n", events[i].event);
+      break;
+    }
+  }
+
+  // Each update is matched with the first flip and the first latch after
+  // it. Updates made before the ISR took the previous one are merged into
+  // it, so they share the same flip and latch.
+  long flipHistogram[HISTOGRAM_N + 1] = { 0 };
+  long latchHistogram[HISTOGRAM_N + 1] = { 0 };
+  long flips = 0, latches = 0, pending = 0;
+  for (int i = 0; i < count; i++) {
+    if ((events[i].event & 0xF0) != TLC5940_TRACE_SET)
+      continue;
+    int flip = -1, latch = -1;
+    for (int j = i + 1; j < count && latch < 0; j++) {
+      int type = events[j].event & 0xF0;
+      if (type == TLC5940_TRACE_FLIP && flip < 0)
+        flip = j;
+      else if (type == TLC5940_TRACE_XLAT && flip >= 0)
+        latch = j;
+    }
+    if (flip >= 0) {
+      long d = events[flip].tick - events[i].tick;
+      flipHistogram[d < HISTOGRAM_N ? d : HISTOGRAM_N]++;
+      flips++;
+    }
+    if (latch >= 0) {
+      long d = events[latch].tick - events[i].tick;
+      latchHistogram[d < HISTOGRAM_N ? d : HISTOGRAM_N]++;
+      latches++;
+    } else {
+      pending++;
+    }
+  }
+  PrintHistogram("Update to flip", flipHistogram, flips);
+  PrintHistogram("Update to latch", latchHistogram, latches);
+  if (pending)
+    printf("\n%ld update(s) not yet latched when the trace was dumped\n", pending);
+
+  free(events);
+  return 0;
+}
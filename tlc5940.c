@@ -31,14 +31,29 @@
 */
 
 #include <avr/interrupt.h>
+#include <stddef.h>
+#include <avr/pgmspace.h>
 #include <util/delay_basic.h>
+#if (TLC5940_ENABLE_CALIBRATION)
+#include <avr/eeprom.h>
+#endif // TLC5940_ENABLE_CALIBRATION
+#if (TLC5940_ENABLE_TWI_SLAVE)
+#include <util/twi.h>
+#endif // TLC5940_ENABLE_TWI_SLAVE
 
 #include "tlc5940.h"
+#if (TLC5940_ENABLE_RENDER)
+#include "tlc5940-render.h"
+#endif // TLC5940_ENABLE_RENDER
 
 #if (TLC5940_ENABLE_MULTIPLEXING)
 
 uint8_t gsData[TLC5940_MULTIPLEX_N][TLC5940_GRAYSCALE_BYTES];
+#if (TLC5940_ENABLE_FRAME_QUEUE)
+static uint8_t gsDataCache[TLC5940_FRAME_QUEUE_N - 1][TLC5940_MULTIPLEX_N][TLC5940_GRAYSCALE_BYTES];
+#else // TLC5940_ENABLE_FRAME_QUEUE
 static uint8_t gsDataCache[TLC5940_MULTIPLEX_N][TLC5940_GRAYSCALE_BYTES];
+#endif // TLC5940_ENABLE_FRAME_QUEUE
 uint8_t *pBack;
 
 // If the pins we are multiplexing across come from the same PORT as XLAT,
@@ -120,10 +135,39 @@ const uint8_t toggleRows[2 * TLC5940_MULTIPLEX_N] = {
   (1 << ROW4_PIN) | TLC5940_TR_EXTRAS, (1 << ROW5_PIN) | TLC5940_TR_EXTRAS,
 #endif // TLC5940_MULTIPLEX_N
 }; // const toggleRows[2 * TLC5940_MULTIPLEX_N]
-#else // TLC5940_ENABLE_MULTIPLEXING
+#elif (TLC5940_ENABLE_RENDER == 0)
 uint8_t gsData[TLC5940_GRAYSCALE_BYTES];
+#if (TLC5940_ENABLE_FRAME_QUEUE)
+static uint8_t gsDataCache[TLC5940_FRAME_QUEUE_N - 1][TLC5940_GRAYSCALE_BYTES];
+uint8_t *pBack;
+#endif // TLC5940_ENABLE_FRAME_QUEUE
 #endif // TLC5940_ENABLE_MULTIPLEXING
 
+#if (TLC5940_ENABLE_FRAME_QUEUE)
+TLC5940_Frame_t TLC5940_frames[TLC5940_FRAME_QUEUE_N];
+volatile uint8_t TLC5940_frameHead;
+volatile uint8_t TLC5940_frameShown;
+#endif // TLC5940_ENABLE_FRAME_QUEUE
+
+#if (TLC5940_ENABLE_TICKS)
+volatile uint16_t TLC5940_ticks;
+#endif // TLC5940_ENABLE_TICKS
+
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+uint32_t TLC5940_power[TLC5940_BUFFERS_N][TLC5940_POWER_ROWS];
+uint8_t TLC5940_powerStale;
+#if (TLC5940_ENABLE_TWI_SLAVE)
+// The TWI ISR marks the buffers it writes here rather than in
+// TLC5940_powerStale, which the main loop changes with read-modify-writes
+// that the interrupt could otherwise land in the middle of
+static volatile uint8_t twiPowerStale;
+#endif // TLC5940_ENABLE_TWI_SLAVE
+#if (TLC5940_INCLUDE_DC_FUNCS)
+uint8_t TLC5940_dc[TLC5940_CHANNELS_N];
+uint16_t TLC5940_dcSum;
+#endif // TLC5940_INCLUDE_DC_FUNCS
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+
 #if (TLC5940_USE_GPIOR0 == 0)
 volatile bool gsUpdateFlag;
 #endif // TLC5940_USE_GPIOR0
@@ -140,7 +184,7 @@ volatile bool gsUpdateFlag;
 #elif (TLC5940_PWM_BITS == 8)
 #define V 255
 #elif (TLC5940_PWM_BITS == 0)
-#define V (((((uint16_t)(uint8_t)(TLC5940_CTC_TOP)) + 1) * 64) - 1)
+#define V (((((uint16_t)(uint8_t)(TLC5940_CTC_TOP)) + 1) * 64 / TLC5940_GSCLK_DIVIDER) - 1)
 #else
 #error "TLC5940_PWM_BITS must be 0, 8, 9, 10, 11, or 12"
 #endif // TLC5940_PWM_BITS
@@ -237,20 +281,141 @@ const uint16_t TLC5940_GammaCorrect[] PROGMEM = {
 #if (TLC5940_CTC_TOP < 3)
 #error "TLC5940_CTC_TOP must be between 3 and 63, inclusive"
 #endif // TLC5940_CTC_TOP
-#if (TLC5940_CTC_TOP > 63)
-#error "TLC5940_CTC_TOP must be between 3 and 63, inclusive"
+#if (TLC5940_CTC_TOP > 64 * TLC5940_GSCLK_DIVIDER - 1)
+#error "TLC5940_CTC_TOP must be between 3 and 63 (or 64 * TLC5940_GSCLK_DIVIDER - 1), inclusive"
 #endif // TLC5940_CTC_TOP
 
 #else
 #error "TLC5940_PWM_BITS must be 0, 8, 9, 10, 11, or 12"
 #endif // TLC5940_PWM_BITS
 
+#if (TLC5940_GSCLK_DIVIDER > 1 && TLC5940_PWM_BITS != 0)
+// Each interrupt still has to come 2^TLC5940_PWM_BITS GSCLK cycles apart,
+// which is TLC5940_GSCLK_DIVIDER times as many clock cycles. The long
+// keeps the arithmetic from overflowing with -mint8.
+#undef TLC5940_CTC_TOP
+#define TLC5940_CTC_TOP (((1L << TLC5940_PWM_BITS) * TLC5940_GSCLK_DIVIDER / 64) - 1)
+#endif // TLC5940_GSCLK_DIVIDER
+
+#if (TLC5940_INCLUDE_DEFAULT_ISR && TLC5940_TIMING_CHECK)
+// Estimated cost of the default ISR, in clock cycles. Each byte
+// takes 16 clocks on the wire in every SPI mode, plus:
+//   SPI:   polling SPIF, then loading and writing the next byte to SPDR
+//   USART: polling UDRE only, since the transmitter is double buffered
+//   USI:   loading USIDR before the 16 USICR strobes
+// These are estimates for the byte loop, and have not been measured. The
+// same costs are used with TLC5940_UNROLL_SHIFT_LOOPS = 1 or 2, so
+// unrolling doesn't let a longer chain through. "make bench" reports the
+// measured cycles per byte, and the largest TLC5940_N that fits, for
+// each setting.
+#if (TLC5940_SPI_MODE == 0)
+#define TLC5940_CYCLES_PER_BYTE 25
+#elif (TLC5940_SPI_MODE == 1)
+#define TLC5940_CYCLES_PER_BYTE 19
+#else // TLC5940_SPI_MODE
+#define TLC5940_CYCLES_PER_BYTE 22
+#endif // TLC5940_SPI_MODE
+
+// Storing the byte received over MISO costs an extra read of SPDR and a
+// store per byte
+#if (TLC5940_ENABLE_STATUS_READBACK)
+#define TLC5940_CYCLES_PER_BYTE_RX 3
+#else // TLC5940_ENABLE_STATUS_READBACK
+#define TLC5940_CYCLES_PER_BYTE_RX 0
+#endif // TLC5940_ENABLE_STATUS_READBACK
+
+// Rendering calls TLC5940_Render() twice for every three bytes, and
+// packing the two 12-bit values and looping costs about 14 more clocks
+#if (TLC5940_ENABLE_RENDER)
+#define TLC5940_CYCLES_PER_BYTE_RENDER ((2 * TLC5940_RENDER_CYCLES + 14 + 2) / 3)
+#else // TLC5940_ENABLE_RENDER
+#define TLC5940_CYCLES_PER_BYTE_RENDER 0
+#endif // TLC5940_ENABLE_RENDER
+
+// Interrupt response, register saves and restores, reti, toggling
+// BLANK/XLAT (and the rows), advancing the row and the page flip. The
+// frame queue adds the tick counter and the promotion check.
+#if (TLC5940_ENABLE_FRAME_QUEUE)
+#define TLC5940_ISR_OVERHEAD_CYCLES 120
+#elif (TLC5940_ENABLE_TICKS)
+#define TLC5940_ISR_OVERHEAD_CYCLES 100
+#else // TLC5940_ENABLE_FRAME_QUEUE
+#define TLC5940_ISR_OVERHEAD_CYCLES 90
+#endif // TLC5940_ENABLE_FRAME_QUEUE
+
+#if (TLC5940_ENABLE_PWM_SWITCHING)
+// The ISR has to keep up at the shortest interval it can be switched to
+#define TLC5940_ISR_PERIOD_CYCLES (1L << TLC5940_PWM_BITS_MIN)
+#else // TLC5940_ENABLE_PWM_SWITCHING
+#define TLC5940_ISR_PERIOD_CYCLES ((TLC5940_CTC_TOP + 1) * 64)
+#endif // TLC5940_ENABLE_PWM_SWITCHING
+#define TLC5940_ISR_BYTE_CYCLES (TLC5940_CYCLES_PER_BYTE + TLC5940_CYCLES_PER_BYTE_RX + TLC5940_CYCLES_PER_BYTE_RENDER)
+#define TLC5940_ISR_CYCLES (TLC5940_ISR_OVERHEAD_CYCLES + 24 * TLC5940_N * TLC5940_ISR_BYTE_CYCLES)
+
+#if (TLC5940_ISR_CYCLES > TLC5940_ISR_PERIOD_CYCLES)
+// The preprocessor can't print the result of its arithmetic, so the
+// report spells out the figures that go into it instead
+#define TLC5940_STRING(x) #x
+#define TLC5940_XSTRING(x) TLC5940_STRING(x)
+#define TLC5940_TIMING_REPORT "The ISR is estimated to take " TLC5940_XSTRING(TLC5940_ISR_OVERHEAD_CYCLES) " + 24 * TLC5940_N * (" TLC5940_XSTRING(TLC5940_CYCLES_PER_BYTE) " + " TLC5940_XSTRING(TLC5940_CYCLES_PER_BYTE_RX) " + " TLC5940_XSTRING(TLC5940_CYCLES_PER_BYTE_RENDER) ") clock cycles, more than the " TLC5940_XSTRING(TLC5940_ISR_PERIOD_CYCLES) " between interrupts"
+#pragma message (TLC5940_TIMING_REPORT)
+#if (TLC5940_TIMING_CHECK == 2)
+#error "The ISR can't shift out 24 * TLC5940_N bytes before the next interrupt. Lower TLC5940_N, raise TLC5940_PWM_BITS (or TLC5940_CTC_TOP, or TLC5940_PWM_BITS_MIN), or use a faster TLC5940_SPI_MODE"
+#endif // TLC5940_TIMING_CHECK
+#endif // TLC5940_ISR_CYCLES
+
+// With TLC5940_HARDWARE_BLANK = 1, OC0B/OC2B raises BLANK on the same
+// compare match that requests the interrupt, and drops it again one timer
+// count (64 clocks) later, so the ISR has to pulse XLAT and switch the
+// rows inside that window. That isn't checked here: from the compare
+// match, it takes the longest section the library runs with interrupts
+// disabled (TLC5940_Trace() or TLC5940_GetTime()), the interrupt
+// response, however many registers the compiler saves for this
+// configuration, and loading the row toggles, none of which the
+// preprocessor can know. "make blank-trace" records the edges in
+// simulavr instead.
+#endif // TLC5940_INCLUDE_DEFAULT_ISR
+
+#if (TLC5940_ENABLE_AUDIO)
+#if (TLC5940_AUDIO_ADC_PRESCALER == 32)
+#define TLC5940_AUDIO_ADPS ((1 << ADPS2) | (1 << ADPS0))
+#elif (TLC5940_AUDIO_ADC_PRESCALER == 64)
+#define TLC5940_AUDIO_ADPS ((1 << ADPS2) | (1 << ADPS1))
+#elif (TLC5940_AUDIO_ADC_PRESCALER == 128)
+#define TLC5940_AUDIO_ADPS ((1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0))
+#else // TLC5940_AUDIO_ADC_PRESCALER
+#error "TLC5940_AUDIO_ADC_PRESCALER must be 32, 64 or 128"
+#endif // TLC5940_AUDIO_ADC_PRESCALER
+
+#if (TLC5940_INCLUDE_DEFAULT_ISR && TLC5940_TIMING_CHECK)
+// Estimated cost of one block, in clock cycles: about 150 per butterfly
+// (four 16x16 multiplies dominate), plus the ADC interrupt, the DC
+// removal, window, magnitude, log and band reduction of every sample.
+// It has to fit in the time that the default ISR leaves free while the
+// ADC takes the next block, at 13 ADC clocks per sample.
+#define TLC5940_AUDIO_CYCLES (150 * (TLC5940_AUDIO_FFT_N / 2) * TLC5940_AUDIO_FFT_LOG2N + 140 * TLC5940_AUDIO_FFT_N)
+#define TLC5940_AUDIO_BLOCK_CYCLES (13 * TLC5940_AUDIO_ADC_PRESCALER * TLC5940_AUDIO_FFT_N)
+#if (TLC5940_AUDIO_CYCLES * TLC5940_ISR_PERIOD_CYCLES > TLC5940_AUDIO_BLOCK_CYCLES * (TLC5940_ISR_PERIOD_CYCLES - TLC5940_ISR_CYCLES))
+#if (TLC5940_TIMING_CHECK == 2)
+#error "TLC5940_Audio_Process() can't keep up with the ADC in the time left over by the ISR. Raise TLC5940_AUDIO_ADC_PRESCALER, or lower TLC5940_AUDIO_FFT_N or TLC5940_N"
+#else // TLC5940_TIMING_CHECK
+#pragma message ("TLC5940_Audio_Process() can't keep up with the ADC in the time left over by the ISR, so blocks will be skipped")
+#endif // TLC5940_TIMING_CHECK
+#endif // TLC5940_AUDIO_CYCLES
+#endif // TLC5940_INCLUDE_DEFAULT_ISR
+#endif // TLC5940_ENABLE_AUDIO
+
 #if (TLC5940_ENABLE_MULTIPLEXING)
 #if (TLC5940_USE_GPIOR1 == 0)
 uint8_t TLC5940_row; // the row we are clocking new data out for
 #endif // TLC5940_USE_GPIOR1
 #endif // TLC5940_ENABLE_MULTIPLEXING
 
+#if (TLC5940_ENABLE_MATRIX)
+// The TLC5940_matrixRows of the frame being shown, taken at the page flip
+static uint8_t TLC5940_matrixShownRows[TLC5940_MULTIPLEX_N];
+#endif // TLC5940_ENABLE_MATRIX
+
 void TLC5940_Init(void) {
   setOutput(SCLK_DDR, SCLK_PIN);
   setLow(SCLK_PORT, SCLK_PIN);
@@ -297,12 +462,93 @@ void TLC5940_Init(void) {
 #endif // TLC5940_MULTIPLEX_N
 
   TLC5940_row = 0; // set this to a known state, since it might be GPIOR1
+#if (TLC5940_ENABLE_FRAME_QUEUE == 0)
   // Initialize the write pointer for page-flipping
   pBack = &gsDataCache[0][0];
+#endif // TLC5940_ENABLE_FRAME_QUEUE
 #else // TLC5940_ENABLE_MULTIPLEXING
   TLC5940_ClearXLATNeedsPulseFlag();
 #endif // TLC5940_ENABLE_MULTIPLEXING
 
+#if (TLC5940_ENABLE_FRAME_QUEUE)
+  // Slot 0 (gsData) is displayed first, and rendering starts in slot 1
+  TLC5940_frames[0].buf = (uint8_t *)gsData;
+  for (uint8_t i = 1; i < TLC5940_FRAME_QUEUE_N; i++)
+    TLC5940_frames[i].buf = (uint8_t *)gsDataCache[i - 1];
+  TLC5940_frameShown = 0;
+  TLC5940_frameHead = 1;
+  pBack = TLC5940_frames[1].buf;
+#endif // TLC5940_ENABLE_FRAME_QUEUE
+
+#if (TLC5940_ENABLE_TICKS)
+  TLC5940_ticks = 0;
+#endif // TLC5940_ENABLE_TICKS
+
+#if (TLC5940_ENABLE_POWER_GOVERNOR && TLC5940_INCLUDE_DC_FUNCS)
+  // The TLC5940 powers up with every DC register at 63
+  for (channel_t i = 0; i < TLC5940_CHANNELS_N; i++)
+    TLC5940_dc[i] = 63;
+  TLC5940_dcSum = (uint16_t)63 * TLC5940_CHANNELS_N;
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+
+#if (TLC5940_ENABLE_MASTER_BRIGHTNESS)
+  TLC5940_masterBrightness = 255;
+#if (TLC5940_ENABLE_MULTIPLEXING)
+  for (uint8_t row = 0; row < TLC5940_MULTIPLEX_N; row++)
+    TLC5940_rowBrightness[row] = 255;
+#endif // TLC5940_ENABLE_MULTIPLEXING
+#endif // TLC5940_ENABLE_MASTER_BRIGHTNESS
+
+#if (TLC5940_ENABLE_PWM_SWITCHING)
+  TLC5940_pwmBits = TLC5940_PWM_BITS;
+  TLC5940_pwmTopPending = 0;
+#endif // TLC5940_ENABLE_PWM_SWITCHING
+
+#if (TLC5940_ENABLE_MATRIX)
+  for (uint8_t y = 0; y < TLC5940_MULTIPLEX_N; y++) {
+    TLC5940_matrixRows[y] = y;
+    TLC5940_matrixShownRows[y] = y;
+  }
+#endif // TLC5940_ENABLE_MATRIX
+
+#if (TLC5940_ENABLE_POV)
+  // Timer1 runs freely at clk_io/64, the same rate as the CTC timer, and
+  // timestamps each index pulse on ICP1 with the noise canceler enabled
+  TCCR1A = 0;
+  TCCR1B = (1 << ICNC1) | (TLC5940_POV_INDEX_EDGE << ICES1) | (1 << CS11) | (1 << CS10);
+  TIMSK1 |= (1 << ICIE1);
+#endif // TLC5940_ENABLE_POV
+
+#if (TLC5940_ENABLE_TWI_SLAVE)
+  // Answer to our own address, and to the general call address for commits
+  TWAR = (TLC5940_TWI_ADDRESS << 1) | (1 << TWGCE);
+  TWCR = (1 << TWEA) | (1 << TWEN) | (1 << TWIE);
+#endif // TLC5940_ENABLE_TWI_SLAVE
+
+#if (TLC5940_ENABLE_AUDIO)
+  // Free-running conversions against AVcc, left adjusted so that only
+  // ADCH has to be read, with an interrupt at the end of each one
+  ADMUX = (1 << REFS0) | (1 << ADLAR) | TLC5940_AUDIO_ADC_CHANNEL;
+  ADCSRB = 0;
+#if (TLC5940_AUDIO_ADC_CHANNEL < 6)
+  DIDR0 = (1 << TLC5940_AUDIO_ADC_CHANNEL);
+#endif // TLC5940_AUDIO_ADC_CHANNEL
+  ADCSRA = (1 << ADEN) | (1 << ADSC) | (1 << ADATE) | (1 << ADIE) | TLC5940_AUDIO_ADPS;
+#endif // TLC5940_ENABLE_AUDIO
+
+#if (TLC5940_ENABLE_SYNC)
+#if (TLC5940_SYNC_LEADER)
+  setLow(SYNC_PORT, SYNC_PIN);
+  setOutput(SYNC_DDR, SYNC_PIN);
+#else // TLC5940_SYNC_LEADER
+  // Interrupt on the rising edge of the sync line, dropping any edge seen
+  // before now
+  EICRA = (1 << ISC01) | (1 << ISC00);
+  EIFR = (1 << INTF0);
+  EIMSK = (1 << INT0);
+#endif // TLC5940_SYNC_LEADER
+#endif // TLC5940_ENABLE_SYNC
+
   setOutput(XLAT_DDR, XLAT_PIN);
   setLow(XLAT_PORT, XLAT_PIN);
 
@@ -343,13 +589,36 @@ void TLC5940_Init(void) {
   UBRR0 = 0;
 #endif // TLC5940_SPI_MODE
 
+#if (TLC5940_GSCLK_DIVIDER > 1)
+  // Fast PWM with ICR1 as TOP and no prescaling, so that OC1A (GSCLK) runs
+  // at F_CPU / TLC5940_GSCLK_DIVIDER with a 50% duty cycle
+  setOutput(GSCLK_DDR, GSCLK_PIN);
+  ICR1 = TLC5940_GSCLK_DIVIDER - 1;
+  OCR1A = TLC5940_GSCLK_DIVIDER / 2 - 1;
+  TCCR1A = (1 << COM1A1) | (1 << WGM11);
+  TCCR1B = (1 << WGM13) | (1 << WGM12) | (1 << CS10);
+#endif // TLC5940_GSCLK_DIVIDER
+
 #if (TLC5940_ISR_CTC_TIMER == 0)
+#if (TLC5940_HARDWARE_BLANK)
+  // Generate an interrupt every (TLC5940_CTC_TOP + 1) * 64 clock cycles,
+  // along with a BLANK pulse on OC0B once TLC5940_ClockInGS() connects it.
+  // Both are written before the timer is put in a PWM mode, where they
+  // would be double buffered.
+  OCR0A = TLC5940_CTC_TOP;
+  OCR0B = TLC5940_CTC_TOP;
+  // Fast PWM with OCR0A as TOP
+  TCCR0A = (1 << WGM01) | (1 << WGM00);
+  // clk_io/64 (From prescaler)
+  TCCR0B = (1 << WGM02) | (1 << CS01) | (1 << CS00);
+#else // TLC5940_HARDWARE_BLANK
   // CTC with OCR0A as TOP
   TCCR0A = (1 << WGM01);
   // clk_io/64 (From prescaler)
   TCCR0B = (1 << CS01) | (1 << CS00);
   // Generate an interrupt every (TLC5940_CTC_TOP + 1) * 64 clock cycles
   OCR0A = TLC5940_CTC_TOP;
+#endif // TLC5940_HARDWARE_BLANK
 
   // Enable Timer/Counter0 Compare Match A interrupt
 #ifdef TIMSK0
@@ -359,12 +628,22 @@ void TLC5940_Init(void) {
 #endif // TIMSK0
 
 #elif (TLC5940_ISR_CTC_TIMER == 2)
+#if (TLC5940_HARDWARE_BLANK)
+  // Same as Timer0 above, with BLANK on OC2B
+  OCR2A = TLC5940_CTC_TOP;
+  OCR2B = TLC5940_CTC_TOP;
+  // Fast PWM with OCR2A as TOP
+  TCCR2A = (1 << WGM21) | (1 << WGM20);
+  // clk_io/64 (From prescaler)
+  TCCR2B = (1 << WGM22) | (1 << CS22);
+#else // TLC5940_HARDWARE_BLANK
   // CTC with OCR2A as TOP
   TCCR2A = (1 << WGM21);
   // clk_io/64 (From prescaler)
   TCCR2B = (1 << CS22);
   // Generate an interrupt every (TLC5940_CTC_TOP + 1) * 64 clock cycles
   OCR2A = TLC5940_CTC_TOP;
+#endif // TLC5940_HARDWARE_BLANK
   // Enable Timer/Counter2 Compare Match A interrupt
   TIMSK2 |= (1 << OCIE2A);
 #else // TLC5940_ISR_CTC_TIMER
@@ -372,7 +651,11 @@ void TLC5940_Init(void) {
 #endif // TLC5940_ISR_CTC_TIMER
 }
 
-void TLC5940_ClockInGS(void) {
+// Shifts in and latches the first grayscale data, and then shifts in the
+// data that the first interrupt will latch. Either one may be NULL to
+// shift in zeroes, otherwise they point to a row of data in PROGMEM.
+static inline void TLC5940_ClockInFirstGS(const uint8_t *first, const uint8_t *second) __attribute__(( always_inline ));
+static inline void TLC5940_ClockInFirstGS(const uint8_t *first, const uint8_t *second) {
   // Manually load in a bunch of dummy data (all zeroes), so the ISR
   // doesn't have to have extra conditionals for firstCycleFlag or
   // worry about having to pulse SCLK one extra time in those cases.
@@ -393,7 +676,7 @@ void TLC5940_ClockInGS(void) {
   // garbage from ever being displayed.
 
   for (gsData_t i = 0; i < TLC5940_GRAYSCALE_BYTES; i++)
-    TLC5940_TX(0x00); // clock in zeroes, since this data will be latched now
+    TLC5940_TX(first ? pgm_read_byte(first + i) : 0x00); // this data will be latched now
 
 #if (TLC5940_SPI_MODE == 1)
   _delay_loop_1(12); // delay until double-buffered TX register is clear
@@ -457,29 +740,1634 @@ void TLC5940_ClockInGS(void) {
 
   // Shift in more zeroes, since the first thing the ISR does is pulse XLAT
   for (gsData_t i = 0; i < TLC5940_GRAYSCALE_BYTES; i++)
-    TLC5940_TX(0x00);
+    TLC5940_TX(second ? pgm_read_byte(second + i) : 0x00);
 
 #if (TLC5940_SPI_MODE == 1)
   _delay_loop_1(12); // delay until double-buffered TX register is clear
 #endif // TLC5940_SPI_MODE
 
+#else // TLC5940_ENABLE_MULTIPLEXING
+  (void)second;
 #endif // TLC5940_ENABLE_MULTIPLEXING
 
-#if (TLC5940_XLAT_AND_BLANK_HARDWIRED_TOGETHER == 0)
+#if (TLC5940_HARDWARE_BLANK)
+  // Hand BLANK over to the CTC timer. In inverting mode, OC0B (or OC2B) is
+  // set by the compare match at TOP, which also fires the interrupt, and
+  // cleared at BOTTOM, so BLANK is high for the last count of each cycle
+  // and the ISR pulses XLAT inside that window.
+#if (TLC5940_ISR_CTC_TIMER == 0)
+  TCCR0A |= (1 << COM0B1) | (1 << COM0B0);
+#else // TLC5940_ISR_CTC_TIMER
+  TCCR2A |= (1 << COM2B1) | (1 << COM2B0);
+#endif // TLC5940_ISR_CTC_TIMER
+#elif (TLC5940_XLAT_AND_BLANK_HARDWIRED_TOGETHER == 0)
   // Set BLANK low, so the ISR can do a toggle, which is quicker
   setLow(BLANK_PORT, BLANK_PIN);
-#endif // TLC5940_XLAT_AND_BLANK_HARDWIRED_TOGETHER
+#endif // TLC5940_HARDWARE_BLANK
+}
+
+void TLC5940_ClockInGS(void) {
+  TLC5940_ClockInFirstGS(NULL, NULL);
+}
+
+#if (TLC5940_INCLUDE_BOOT_FRAME)
+#if (TLC5940_INCLUDE_DC_FUNCS)
+void TLC5940_ClockInBootFrame(const uint8_t *gs, const uint8_t *dc) {
+  if (dc) {
+    // Same as TLC5940_ClockInDC(), but straight out of PROGMEM
+#if (TLC5940_DCPRG_HARDWIRED_TO_VCC == 0)
+    setHigh(DCPRG_PORT, DCPRG_PIN);
+#endif // TLC5940_DCPRG_HARDWIRED_TO_VCC
+    setHigh(VPRG_PORT, VPRG_PIN);
+    for (dcData_t i = 0; i < TLC5940_DOT_CORRECTION_BYTES; i++)
+      TLC5940_TX(pgm_read_byte(dc + i));
+#if (TLC5940_SPI_MODE == 1)
+    _delay_loop_1(12); // delay until double-buffered TX register is clear
+#endif // TLC5940_SPI_MODE
+    pulse(XLAT_PORT, XLAT_PIN);
+  }
+#else // TLC5940_INCLUDE_DC_FUNCS
+void TLC5940_ClockInBootFrame(const uint8_t *gs) {
+#endif // TLC5940_INCLUDE_DC_FUNCS
+
+#if (TLC5940_ENABLE_MULTIPLEXING)
+  // The first data latched is shown on the second to last row until the
+  // first interrupt, which latches the data for the last row
+  TLC5940_ClockInFirstGS(gs + (gsOffset_t)TLC5940_GRAYSCALE_BYTES * ((TLC5940_MULTIPLEX_N + TLC5940_MULTIPLEX_N - 2) % TLC5940_MULTIPLEX_N),
+                         gs + (gsOffset_t)TLC5940_GRAYSCALE_BYTES * (TLC5940_MULTIPLEX_N - 1));
+#else // TLC5940_ENABLE_MULTIPLEXING
+  TLC5940_ClockInFirstGS(gs, NULL);
+#endif // TLC5940_ENABLE_MULTIPLEXING
+
+  // The outputs are already lit, so there is no hurry now. The frame is
+  // copied into both gsData and the back buffer, since the update flag
+  // set by TLC5940_Init() makes the first interrupt use the back buffer
+  // when multiplexing, but gsData otherwise.
+  uint8_t *pData = (uint8_t *)gsData;
+  for (gsFrame_t i = 0; i < TLC5940_FRAME_BYTES; i++) {
+    uint8_t data = pgm_read_byte(gs + i);
+    *(pData + i) = data;
+#if (TLC5940_ENABLE_MULTIPLEXING || TLC5940_ENABLE_FRAME_QUEUE)
+    *(pBack + i) = data;
+#endif // TLC5940_ENABLE_MULTIPLEXING
+#if (TLC5940_ENABLE_MASTER_BRIGHTNESS)
+    TLC5940_gsUnscaled[i] = data;
+#endif // TLC5940_ENABLE_MASTER_BRIGHTNESS
+  }
+
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+#if (TLC5940_INCLUDE_DC_FUNCS)
+  if (dc) {
+    // Unpack the DC profile into the shadow copy, four channels at a time
+    TLC5940_dcSum = 0;
+    for (channel_t i = 0; i < TLC5940_CHANNELS_N; i += 4) {
+      uint8_t b0 = pgm_read_byte(dc++);
+      uint8_t b1 = pgm_read_byte(dc++);
+      uint8_t b2 = pgm_read_byte(dc++);
+      TLC5940_dc[i] = b0 >> 2;
+      TLC5940_dc[i + 1] = ((b0 & 0x03) << 4) | (b1 >> 4);
+      TLC5940_dc[i + 2] = ((b1 & 0x0F) << 2) | (b2 >> 6);
+      TLC5940_dc[i + 3] = b2 & 0x3F;
+      for (uint8_t j = 0; j < 4; j++)
+        TLC5940_dcSum += TLC5940_dc[i + j];
+    }
+  }
+#endif // TLC5940_INCLUDE_DC_FUNCS
+  TLC5940_powerStale = TLC5940_POWER_ALL_STALE;
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+}
+#endif // TLC5940_INCLUDE_BOOT_FRAME
+
+#if (TLC5940_ENABLE_GS_QUEUE)
+TLC5940_GSCommand_t TLC5940_gsQueue[TLC5940_GS_QUEUE_SIZE];
+volatile uint8_t TLC5940_gsQueueHead;
+volatile uint8_t TLC5940_gsQueueTail;
+
+// How far into the queue each buffer in rotation has been updated. A
+// slot is only freed once its command has been applied to every buffer,
+// the same way a dirty group of the layers stays dirty until every
+// buffer has been recomposited.
+static uint8_t gsQueueApplied[TLC5940_DRAW_BUFFERS_N];
+static uint8_t gsQueueBuffer;
+
+uint8_t TLC5940_DrainGSQueue(void) {
+  uint8_t pos = gsQueueApplied[gsQueueBuffer];
+  uint8_t n = 0;
+
+  // Reading the head once bounds the work to what was queued on entry
+  uint8_t count = TLC5940_gsQueueHead - pos;
+  if (count > TLC5940_GS_QUEUE_BATCH)
+    count = TLC5940_GS_QUEUE_BATCH;
+  __asm__ volatile ("" ::: "memory"); // read the head before any commands
+
+  while (n < count) {
+    const TLC5940_GSCommand_t *p = &TLC5940_gsQueue[pos++ & (TLC5940_GS_QUEUE_SIZE - 1)];
+#if (TLC5940_ENABLE_MULTIPLEXING)
+    TLC5940_SetGS(p->row, p->channel, p->value);
+#else // TLC5940_ENABLE_MULTIPLEXING
+    TLC5940_SetGS(p->channel, p->value);
+#endif // TLC5940_ENABLE_MULTIPLEXING
+    n++;
+  }
+  gsQueueApplied[gsQueueBuffer] = pos;
+
+  // The new tail is whichever buffer is furthest behind
+  uint8_t tail = TLC5940_gsQueueTail;
+  uint8_t behind = pos - tail;
+  for (uint8_t b = 0; b < TLC5940_DRAW_BUFFERS_N; b++)
+    if ((uint8_t)(gsQueueApplied[b] - tail) < behind)
+      behind = gsQueueApplied[b] - tail;
+
+  // The next call writes into the next buffer in rotation
+  if (++gsQueueBuffer == TLC5940_DRAW_BUFFERS_N)
+    gsQueueBuffer = 0;
+
+  __asm__ volatile ("" ::: "memory"); // finish reading before freeing slots
+  TLC5940_gsQueueTail = tail + behind;
+  return n;
+}
+#endif // TLC5940_ENABLE_GS_QUEUE
+
+#if (TLC5940_INCLUDE_CROSSFADE)
+static const uint8_t *crossfadeFrom;
+static const uint8_t *crossfadeTo;
+static gsFrame_t crossfadeOffset;
+static uint8_t crossfadeAlpha;
+
+// Blends the bytes [offset, end) of the back buffer, three at a time
+static void TLC5940_CrossfadeRange(gsFrame_t offset, gsFrame_t end) {
+  const uint8_t *pFrom = crossfadeFrom + offset;
+  const uint8_t *pTo = crossfadeTo + offset;
+  uint8_t *p = &TLC5940_GS_BACK[0] + offset;
+  uint8_t alpha = crossfadeAlpha;
+
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+  TLC5940_MarkPowerStale();
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+
+  if (alpha == 255) {
+    while (offset++ < end)
+      *p++ = *pTo++;
+    return;
+  }
+
+  for (; offset < end; offset += 3) {
+    uint8_t a0 = *pFrom++;
+    uint8_t a1 = *pFrom++;
+    uint8_t a2 = *pFrom++;
+    uint8_t b0 = *pTo++;
+    uint8_t b1 = *pTo++;
+    uint8_t b2 = *pTo++;
+
+    // bits: 11 10 09 08 07 06 05 04 | 03 02 01 00 -- -- -- --
+    uint16_t v0 = TLC5940_LerpGS(((uint16_t)a0 << 4) | (a1 >> 4),
+                                 ((uint16_t)b0 << 4) | (b1 >> 4), alpha);
+    // bits: -- -- -- -- 11 10 09 08 | 07 06 05 04 03 02 01 00
+    uint16_t v1 = TLC5940_LerpGS(((uint16_t)(a1 & 0x0F) << 8) | a2,
+                                 ((uint16_t)(b1 & 0x0F) << 8) | b2, alpha);
+
+    *p++ = (v0 >> 4);                                  // bits: 11 10 09 08 07 06 05 04
+    *p++ = (uint8_t)(v0 << 4) | (uint8_t)(v1 >> 8);    // bits: 03 02 01 00 11 10 09 08
+    *p++ = (uint8_t)v1;                                // bits: 07 06 05 04 03 02 01 00
+  }
+}
+
+void TLC5940_Crossfade(const uint8_t *from, const uint8_t *to, uint8_t alpha) {
+  TLC5940_CrossfadeBegin(from, to, alpha);
+  TLC5940_CrossfadeRange(0, TLC5940_FRAME_BYTES);
+}
+
+void TLC5940_CrossfadeBegin(const uint8_t *from, const uint8_t *to, uint8_t alpha) {
+  crossfadeFrom = from;
+  crossfadeTo = to;
+  crossfadeAlpha = alpha;
+  crossfadeOffset = 0;
+}
+
+bool TLC5940_CrossfadeStep(channel_t channels) {
+  gsFrame_t offset = crossfadeOffset;
+  gsFrame_t remaining = TLC5940_FRAME_BYTES - offset;
+  uint16_t n = ((uint16_t)channels + 1) / 2 * 3;
+
+  if (n == 0 || n > remaining)
+    n = remaining;
+  TLC5940_CrossfadeRange(offset, offset + n);
+  crossfadeOffset = offset + n;
+  return crossfadeOffset == TLC5940_FRAME_BYTES;
+}
+#endif // TLC5940_INCLUDE_CROSSFADE
+
+#if (TLC5940_INCLUDE_HSV)
+// Returns a * (b + 1) / 256, which maps b = 255 back onto a exactly
+static inline uint8_t TLC5940_Scale8(uint8_t a, uint8_t b) __attribute__(( always_inline ));
+static inline uint8_t TLC5940_Scale8(uint8_t a, uint8_t b) {
+  return ((uint16_t)a * b + a) >> 8;
+}
+
+static inline void TLC5940_HSVtoRGB(uint16_t hue, uint8_t saturation, uint8_t value, uint16_t *r, uint16_t *g, uint16_t *b) __attribute__(( always_inline ));
+static inline void TLC5940_HSVtoRGB(uint16_t hue, uint8_t saturation, uint8_t value, uint16_t *r, uint16_t *g, uint16_t *b) {
+  // Split hue * 6 into a sector (0-5) and a position within that sector
+  // (0-255), using two 8x8 multiplies rather than a 16x8 multiply
+  uint16_t h6 = (uint16_t)(uint8_t)(hue >> 8) * 6 + (((uint16_t)(uint8_t)hue * 6) >> 8);
+  uint8_t sector = h6 >> 8;
+  uint8_t f = (uint8_t)h6;
+
+  uint8_t p = TLC5940_Scale8(value, 255 - saturation);
+  uint8_t q = TLC5940_Scale8(value, 255 - TLC5940_Scale8(saturation, f));
+  uint8_t t = TLC5940_Scale8(value, 255 - TLC5940_Scale8(saturation, 255 - f));
+  uint8_t red, green, blue;
+
+  switch (sector) {
+  case 0:
+    red = value; green = t; blue = p;
+    break;
+  case 1:
+    red = q; green = value; blue = p;
+    break;
+  case 2:
+    red = p; green = value; blue = t;
+    break;
+  case 3:
+    red = p; green = q; blue = value;
+    break;
+  case 4:
+    red = t; green = p; blue = value;
+    break;
+  default: // case 5:
+    red = value; green = p; blue = q;
+    break;
+  }
+
+  *r = TLC5940_GammaCorrect(red);
+  *g = TLC5940_GammaCorrect(green);
+  *b = TLC5940_GammaCorrect(blue);
+}
+
+void TLC5940_HSVtoGS(uint16_t hue, uint8_t saturation, uint8_t value, uint16_t *r, uint16_t *g, uint16_t *b) {
+  TLC5940_HSVtoRGB(hue, saturation, value, r, g, b);
+}
+
+#if (TLC5940_ENABLE_MULTIPLEXING && TLC5940_MULTIPLEX_N >= 3)
+void TLC5940_SetAllHSV(const TLC5940_HSV_t *hsv) {
+  // Channels are stored in reverse order, so channel 0 is in the last
+  // three bytes of each row, followed by channel 1 in front of it
+  uint8_t *p = &TLC5940_GS_BACK[0] + TLC5940_GRAYSCALE_BYTES - 3;
+
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+  TLC5940_MarkPowerStale();
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+
+  for (channel_t i = 0; i < TLC5940_CHANNELS_N; i += 2) {
+    uint16_t c0[3];
+    uint16_t c1[3];
+    TLC5940_HSVtoRGB(hsv->hue, hsv->saturation, hsv->value, &c0[0], &c0[1], &c0[2]);
+    hsv++;
+    TLC5940_HSVtoRGB(hsv->hue, hsv->saturation, hsv->value, &c1[0], &c1[1], &c1[2]);
+    hsv++;
+
+    gsOffset_t offset = 0;
+    for (uint8_t row = 0; row < 3; row++) {
+      *(p + offset) = (c1[row] >> 4);                                       // bits: 11 10 09 08 07 06 05 04
+      *(p + offset + 1) = (uint8_t)(c1[row] << 4) | (uint8_t)(c0[row] >> 8); // bits: 03 02 01 00 11 10 09 08
+      *(p + offset + 2) = (uint8_t)c0[row];                                 // bits: 07 06 05 04 03 02 01 00
+      offset += TLC5940_GRAYSCALE_BYTES;
+    }
+    p -= 3;
+  }
+}
+#endif // TLC5940_ENABLE_MULTIPLEXING
+#endif // TLC5940_INCLUDE_HSV
+
+#if (TLC5940_INCLUDE_COLOR_MATRIX)
+int8_t TLC5940_colorMatrix[3][3] = {
+  { TLC5940_COLOR_MATRIX_ONE, 0, 0 },
+  { 0, TLC5940_COLOR_MATRIX_ONE, 0 },
+  { 0, 0, TLC5940_COLOR_MATRIX_ONE }
+};
+
+// Each product is a single signed x unsigned 8x8 hardware multiply
+// (mulsu), and since the coefficients of a row add up to no more than
+// 127, the sum of three of them always fits in 16 bits
+static inline uint16_t TLC5940_MatrixRow(const int8_t *m, const uint8_t *rgb) __attribute__(( always_inline ));
+static inline uint16_t TLC5940_MatrixRow(const int8_t *m, const uint8_t *rgb) {
+  int16_t sum = (int16_t)m[0] * rgb[0];
+  sum += (int16_t)m[1] * rgb[1];
+  sum += (int16_t)m[2] * rgb[2];
+  if (sum < 0)
+    return TLC5940_GammaCorrect(0);
+  sum = (sum + TLC5940_COLOR_MATRIX_ONE / 2) >> 6;
+  if (sum > 255)
+    sum = 255;
+  return TLC5940_GammaCorrect((uint8_t)sum);
+}
+
+void TLC5940_SetAllRGB(const uint8_t *rgb) {
+  // Channels are stored in reverse order, so channel 0 is in the last
+  // three bytes of each row, followed by channel 1 in front of it
+  uint8_t *p = &TLC5940_GS_BACK[0] + TLC5940_GRAYSCALE_BYTES - 3;
+
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+  TLC5940_MarkPowerStale();
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+
+  for (channel_t i = 0; i < TLC5940_CHANNELS_N; i += 2) {
+    gsOffset_t offset = 0;
+    for (uint8_t row = 0; row < 3; row++) {
+      const int8_t *m = TLC5940_colorMatrix[row];
+      uint16_t c0 = TLC5940_MatrixRow(m, rgb);
+      uint16_t c1 = TLC5940_MatrixRow(m, rgb + 3);
+      *(p + offset) = (c1 >> 4);                                 // bits: 11 10 09 08 07 06 05 04
+      *(p + offset + 1) = (uint8_t)(c1 << 4) | (uint8_t)(c0 >> 8); // bits: 03 02 01 00 11 10 09 08
+      *(p + offset + 2) = (uint8_t)c0;                           // bits: 07 06 05 04 03 02 01 00
+      offset += TLC5940_GRAYSCALE_BYTES;
+    }
+    rgb += 6;
+    p -= 3;
+  }
+}
+#endif // TLC5940_INCLUDE_COLOR_MATRIX
+
+#if (TLC5940_ENABLE_LAYERS)
+#define TLC5940_DIRTY_GROUPS_N (TLC5940_FRAME_BYTES / 3)
+#define TLC5940_DIRTY_BYTES ((TLC5940_DIRTY_GROUPS_N + 7) / 8)
+
+TLC5940_Layer_t TLC5940_layers[TLC5940_LAYERS_N];
+static const uint8_t *composeBase;
+
+// One bitmap of dirty three byte groups per buffer in rotation. Marks
+// always go into dirtyGroups[dirtyIndex], and a group stays dirty until
+// every buffer has been recomposited since it was marked.
+static uint8_t dirtyGroups[TLC5940_DRAW_BUFFERS_N][TLC5940_DIRTY_BYTES];
+static uint8_t dirtyIndex;
+
+static inline void TLC5940_MarkGroup(gsFrame_t group) __attribute__(( always_inline ));
+static inline void TLC5940_MarkGroup(gsFrame_t group) {
+  dirtyGroups[dirtyIndex][group >> 3] |= (uint8_t)(1 << (group & 7));
+}
+
+void TLC5940_MarkDirty(gsFrame_t start, gsFrame_t end) {
+  for (gsFrame_t group = start / 3; group < (end + 2) / 3; group++)
+    TLC5940_MarkGroup(group);
+}
+
+void TLC5940_SetBaseFrame(const uint8_t *base) {
+  composeBase = base;
+  TLC5940_MarkDirty(0, TLC5940_FRAME_BYTES);
+}
+
+void TLC5940_SetLayer(uint8_t layer, uint8_t *data, gsFrame_t start, gsFrame_t end, uint8_t mode, uint8_t alpha) {
+  TLC5940_Layer_t *p = &TLC5940_layers[layer];
+  TLC5940_MarkDirty(p->start, p->end);
+  p->data = data;
+  p->start = start;
+  p->end = end;
+  p->mode = mode;
+  p->alpha = alpha;
+  TLC5940_MarkDirty(start, end);
+}
+
+#if (TLC5940_ENABLE_MULTIPLEXING)
+void TLC5940_SetLayerGS(uint8_t layer, uint8_t row, channel_t channel, uint16_t value) {
+#else // TLC5940_ENABLE_MULTIPLEXING
+void TLC5940_SetLayerGS(uint8_t layer, channel_t channel, uint16_t value) {
+#endif // TLC5940_ENABLE_MULTIPLEXING
+  const TLC5940_Layer_t *p = &TLC5940_layers[layer];
+  channel = TLC5940_CHANNELS_N - 1 - channel;
+  gsFrame_t group = channel / 2;
+#if (TLC5940_ENABLE_MULTIPLEXING)
+  group += (gsFrame_t)(TLC5940_CHANNELS_N / 2) * row;
+#endif // TLC5940_ENABLE_MULTIPLEXING
+  gsFrame_t offset = group * 3;
+
+  if (offset < p->start || offset >= p->end)
+    return;
+
+  uint8_t *pData = p->data + (offset - p->start);
+  switch (channel % 2) {
+  case 0:
+    *pData++ = (value >> 4);
+    *pData = (*pData & 0x0F) | (uint8_t)(value << 4);
+    break;
+  default: // case 1:
+    pData++;
+    *pData = (*pData & 0xF0) | (value >> 8);
+    *++pData = (uint8_t)value;
+    break;
+  }
+  TLC5940_MarkGroup(group);
+}
+
+static inline uint16_t TLC5940_Blend(uint16_t base, uint16_t value, uint8_t mode, uint8_t alpha) __attribute__(( always_inline ));
+static inline uint16_t TLC5940_Blend(uint16_t base, uint16_t value, uint8_t mode, uint8_t alpha) {
+  switch (mode) {
+  case TLC5940_BLEND_ADD:
+    value += base;
+    return (value > 4095) ? 4095 : value;
+  case TLC5940_BLEND_MAX:
+    return (value > base) ? value : base;
+  default: // case TLC5940_BLEND_ALPHA:
+    return (alpha == 255) ? value : TLC5940_LerpGS(base, value, alpha);
+  }
+}
+
+// Rebuilds three bytes (two channels) of the back buffer from the base
+// frame and every layer that covers them
+static void TLC5940_ComposeGroup(uint8_t *pOut, gsFrame_t offset) {
+  const uint8_t *p = composeBase + offset;
+  uint16_t v0 = ((uint16_t)*p << 4) | (*(p + 1) >> 4);
+  uint16_t v1 = ((uint16_t)(*(p + 1) & 0x0F) << 8) | *(p + 2);
+
+  const TLC5940_Layer_t *pLayer = &TLC5940_layers[0];
+  for (uint8_t i = 0; i < TLC5940_LAYERS_N; i++, pLayer++) {
+    if (offset < pLayer->start || offset >= pLayer->end)
+      continue;
+    p = pLayer->data + (offset - pLayer->start);
+    v0 = TLC5940_Blend(v0, ((uint16_t)*p << 4) | (*(p + 1) >> 4), pLayer->mode, pLayer->alpha);
+    v1 = TLC5940_Blend(v1, ((uint16_t)(*(p + 1) & 0x0F) << 8) | *(p + 2), pLayer->mode, pLayer->alpha);
+  }
+
+  pOut += offset;
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+  // Only the dirty groups are rewritten, so account for them one by one
+  gsFrame_t group = offset / 3;
+  uint8_t row = group / (TLC5940_CHANNELS_N / 2);
+  channel_t channel = (group % (TLC5940_CHANNELS_N / 2)) * 2;
+  TLC5940_AccountGS(row, channel, TLC5940_GetPackedGS(pOut, 0), v0);
+  TLC5940_AccountGS(row, channel + 1, TLC5940_GetPackedGS(pOut, 1), v1);
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+  *pOut++ = (v0 >> 4);                               // bits: 11 10 09 08 07 06 05 04
+  *pOut++ = (uint8_t)(v0 << 4) | (uint8_t)(v1 >> 8); // bits: 03 02 01 00 11 10 09 08
+  *pOut = (uint8_t)v1;                               // bits: 07 06 05 04 03 02 01 00
+}
+
+void TLC5940_Compose(void) {
+  uint8_t *pOut = &TLC5940_GS_BACK[0];
+
+  // Whole bytes of the bitmaps are skipped at once, so the cost of
+  // composing mostly depends on how many groups are actually dirty
+  for (gsFrame_t i = 0; i < TLC5940_DIRTY_BYTES; i++) {
+    uint8_t bits = 0;
+    for (uint8_t b = 0; b < TLC5940_DRAW_BUFFERS_N; b++)
+      bits |= dirtyGroups[b][i];
+    if (bits == 0)
+      continue;
+
+    gsFrame_t offset = i * 8 * 3;
+    for (; bits; bits >>= 1, offset += 3)
+      if (bits & 1)
+        TLC5940_ComposeGroup(pOut, offset);
+  }
+
+  // The oldest bitmap has now been applied to every buffer
+  if (++dirtyIndex == TLC5940_DRAW_BUFFERS_N)
+    dirtyIndex = 0;
+  for (gsFrame_t i = 0; i < TLC5940_DIRTY_BYTES; i++)
+    dirtyGroups[dirtyIndex][i] = 0;
+}
+#endif // TLC5940_ENABLE_LAYERS
+
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+// Recounts every row of the back buffer, first scaling each channel by
+// factor / 256 if 'scale' is true, and returns the busiest row's total
+static uint32_t TLC5940_PowerPass(bool scale, uint8_t factor) {
+  uint8_t index = TLC5940_GetBackIndex();
+  uint8_t *p = &TLC5940_GS_OUT[0];
+  uint32_t peak = 0;
+
+  for (uint8_t row = 0; row < TLC5940_POWER_ROWS; row++) {
+    uint32_t total = 0;
+    for (channel_t channel = 0; channel < TLC5940_CHANNELS_N; channel += 2) {
+      uint16_t v0 = TLC5940_GetPackedGS(p, 0);
+      uint16_t v1 = TLC5940_GetPackedGS(p, 1);
+      if (scale) {
+        v0 = TLC5940_ScaleGS(v0, factor);
+        v1 = TLC5940_ScaleGS(v1, factor);
+        *p = (v0 >> 4);                                     // bits: 11 10 09 08 07 06 05 04
+        *(p + 1) = (uint8_t)(v0 << 4) | (uint8_t)(v1 >> 8); // bits: 03 02 01 00 11 10 09 08
+        *(p + 2) = (uint8_t)v1;                             // bits: 07 06 05 04 03 02 01 00
+      }
+      total += (uint32_t)v0 * TLC5940_GetChannelDC(channel);
+      total += (uint32_t)v1 * TLC5940_GetChannelDC(channel + 1);
+      p += 3;
+    }
+    TLC5940_power[index][row] = total;
+    if (total > peak)
+      peak = total;
+  }
+
+  TLC5940_powerStale &= (uint8_t)~((uint8_t)1 << index);
+  return peak;
+}
+
+uint32_t TLC5940_GetPower(void) {
+#if (TLC5940_ENABLE_TWI_SLAVE)
+  uint8_t sreg = SREG;
+  cli();
+  TLC5940_powerStale |= twiPowerStale;
+  twiPowerStale = 0;
+  SREG = sreg;
+#endif // TLC5940_ENABLE_TWI_SLAVE
+  uint8_t index = TLC5940_GetBackIndex();
+  if (TLC5940_powerStale & (uint8_t)((uint8_t)1 << index))
+    return TLC5940_PowerPass(false, 0);
+
+  uint32_t peak = 0;
+  for (uint8_t row = 0; row < TLC5940_POWER_ROWS; row++)
+    if (TLC5940_power[index][row] > peak)
+      peak = TLC5940_power[index][row];
+  return peak;
+}
+
+bool TLC5940_ApplyPowerBudget(void) {
+  uint32_t peak = TLC5940_GetPower();
+  if (peak <= TLC5940_POWER_BUDGET)
+    return false;
+
+  // Rounding the divisor up keeps the factor below 256, and guarantees
+  // that peak * factor / 256 <= TLC5940_POWER_BUDGET
+  TLC5940_PowerPass(true, TLC5940_POWER_BUDGET / ((peak + 255) >> 8));
+  return true;
+}
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+
+#if (TLC5940_ENABLE_POV || TLC5940_ENABLE_SCHEDULER || TLC5940_ENABLE_SYNC)
+#if (TLC5940_ISR_CTC_TIMER == 0)
+#define TLC5940_CTC_TCNT TCNT0
+#define TLC5940_CTC_TIFR TIFR0
+#define TLC5940_CTC_OCF OCF0A
+#else // TLC5940_ISR_CTC_TIMER
+#define TLC5940_CTC_TCNT TCNT2
+#define TLC5940_CTC_TIFR TIFR2
+#define TLC5940_CTC_OCF OCF2A
+#endif // TLC5940_ISR_CTC_TIMER
+#endif // TLC5940_ENABLE_POV || TLC5940_ENABLE_SCHEDULER || TLC5940_ENABLE_SYNC
+
+#if (TLC5940_ENABLE_POV)
+// All times are kept in 1/256ths of a tick (one CTC interrupt interval),
+// so they wrap around every 2^24, along with TLC5940_ticks. Both timers
+// count at clk_io/64, so a count of either one is 256 / (CTC_TOP + 1) of
+// these.
+#define TLC5940_POV_MASK 0xFFFFFFUL
+#define TLC5940_POV_COUNTS(count) ((uint32_t)(count) * 256 / (TLC5940_CTC_TOP + 1))
+
+// Written only by the input capture ISR. povSeq is incremented after
+// everything else, so the main loop can tell when it read a torn copy.
+static volatile uint32_t povIndex; // time of the latest index pulse
+static volatile uint32_t povHistory[TLC5940_POV_HISTORY]; // revolution periods
+static volatile uint8_t povHistoryIndex; // slot holding the oldest period
+static volatile uint8_t povValid; // number of pulses timed since (re)starting
+static volatile uint8_t povSeq;
+
+// Only ever touched by the main loop
+static uint32_t povBase; // time of the index pulse that povColumn counts from
+static uint32_t povRev; // predicted period of that revolution
+static uint8_t povColumn;
+static uint8_t povSeen; // value of povSeq the schedule was last synced to
+static bool povWrapped; // set once povBase is a prediction, not a capture
+static bool povStopped;
+static uint8_t povStoppedSeq;
+
+ISR(TIMER1_CAPT_vect) {
+  uint16_t capture = ICR1;
+  uint16_t age = TCNT1 - capture;
+  uint8_t count = TLC5940_CTC_TCNT;
+  uint16_t ticks = TLC5940_ticks;
+  if (TLC5940_CTC_TIFR & (1 << TLC5940_CTC_OCF)) {
+    // The CTC interrupt is pending, so TLC5940_ticks is one behind, and
+    // the count has to be read again in case it wrapped after the first read
+    count = TLC5940_CTC_TCNT;
+    ticks++;
+  }
+
+  uint32_t index = (((uint32_t)ticks << 8) + TLC5940_POV_COUNTS(count) - TLC5940_POV_COUNTS(age)) & TLC5940_POV_MASK;
+  uint32_t period = (index - povIndex) & TLC5940_POV_MASK;
+  povIndex = index;
+
+  uint8_t valid = povValid;
+  uint8_t i = povHistoryIndex;
+  if (valid > 1) {
+    // A revolution more than twice as long as the one before it means
+    // the display stopped, so the history is no longer any good
+    uint32_t last = povHistory[(i - 1) & (TLC5940_POV_HISTORY - 1)];
+    if (period > 2 * last)
+      valid = 0;
+  }
+  if (valid) {
+    povHistory[i] = period;
+    povHistoryIndex = (i + 1) & (TLC5940_POV_HISTORY - 1);
+  }
+  if (valid <= TLC5940_POV_HISTORY)
+    valid++;
+  povValid = valid;
+  povSeq++;
+}
+
+// Returns a consistent copy of what the input capture ISR has recorded
+static uint8_t TLC5940_POV_Read(uint32_t *index, uint32_t *history, uint8_t *valid) {
+  uint8_t seq;
+  do {
+    seq = povSeq;
+    *index = povIndex;
+    uint8_t i = povHistoryIndex;
+    // Oldest period first
+    for (uint8_t j = 0; j < TLC5940_POV_HISTORY; j++)
+      history[j] = povHistory[(i + j) & (TLC5940_POV_HISTORY - 1)];
+    *valid = povValid;
+  } while (seq != povSeq);
+  return seq;
+}
+
+bool TLC5940_POV_GetSpinning(void) {
+  uint32_t index;
+  uint32_t history[TLC5940_POV_HISTORY];
+  uint8_t valid;
+  uint8_t seq = TLC5940_POV_Read(&index, history, &valid);
+
+  if (valid <= TLC5940_POV_HISTORY || (povStopped && seq == povStoppedSeq))
+    return false;
+
+  // The index pulse may be up to a tick ahead of the current tick, in
+  // which case the difference is negative (bit 23 set)
+  uint32_t elapsed = (((uint32_t)TLC5940_GetTicks() << 8) - index) & TLC5940_POV_MASK;
+  if (elapsed < 0x800000UL && elapsed > 2 * history[TLC5940_POV_HISTORY - 1]) {
+    // Latch this, since the elapsed time wraps around eventually
+    povStopped = true;
+    povStoppedSeq = seq;
+    return false;
+  }
+  povStopped = false;
+  return true;
+}
+
+static uint32_t TLC5940_POV_ColumnTime(uint8_t column) {
+  return (povBase + (uint32_t)column * povRev / TLC5940_POV_COLUMNS) & TLC5940_POV_MASK;
+}
+
+static void TLC5940_POV_Advance(void) {
+  if (++povColumn == TLC5940_POV_COLUMNS) {
+    povColumn = 0;
+    povBase = (povBase + povRev) & TLC5940_POV_MASK;
+    povWrapped = true;
+  }
+}
+
+uint8_t TLC5940_POV_NextColumn(void) {
+  uint32_t index;
+  uint32_t history[TLC5940_POV_HISTORY];
+  uint8_t valid;
+  uint8_t seq = TLC5940_POV_Read(&index, history, &valid);
+
+  if (seq != povSeen) {
+    povSeen = seq;
+
+    // Fit a line through the recent revolution periods, and extend it to
+    // the revolution that just started. The mean lies (HISTORY - 1) / 2
+    // revolutions back, so that is (HISTORY + 1) / 2 slopes ahead of it.
+    uint32_t sum = 0;
+    for (uint8_t j = 0; j < TLC5940_POV_HISTORY; j++)
+      sum += history[j];
+    int32_t rise = (int32_t)history[TLC5940_POV_HISTORY - 1] - (int32_t)history[0];
+    int32_t rev = (int32_t)(sum / TLC5940_POV_HISTORY) + rise * (TLC5940_POV_HISTORY + 1) / (2 * (TLC5940_POV_HISTORY - 1));
+    povRev = (rev > 0) ? (uint32_t)rev : history[TLC5940_POV_HISTORY - 1];
+
+    // If the columns already queued were predicted to be in this
+    // revolution, carry on from there, otherwise the display sped up
+    // and the rest of the last revolution has to be dropped
+    if (!povWrapped)
+      povColumn = 0;
+    povBase = index;
+    povWrapped = false;
+  }
+
+  // A frame can't be latched any sooner than the next tick
+  uint32_t now = (uint32_t)(uint16_t)(TLC5940_GetTicks() + 1) << 8;
+  while ((int32_t)((TLC5940_POV_ColumnTime(povColumn) - now) << 8) < 0)
+    TLC5940_POV_Advance();
+
+  return povColumn;
+}
+
+void TLC5940_POV_QueueColumn(void) {
+  // Round to the nearest tick, which keeps the error within half a tick
+  uint32_t time = TLC5940_POV_ColumnTime(povColumn);
+  TLC5940_QueueFrame((uint16_t)((time + 128) >> 8));
+  TLC5940_POV_Advance();
+}
+#endif // TLC5940_ENABLE_POV
+
+#if (TLC5940_ENABLE_CALIBRATION)
+uint8_t TLC5940_gain[TLC5940_CALIBRATION_ROWS][TLC5940_CHANNELS_N];
+
+bool TLC5940_LoadCalibration(void) {
+  const uint8_t *p = (const uint8_t *)(TLC5940_CALIBRATION_ADDRESS);
+  uint8_t *pGain = &TLC5940_gain[0][0];
+  for (uint16_t i = 0; i < (uint16_t)TLC5940_CALIBRATION_ROWS * TLC5940_CHANNELS_N; i++)
+    *(pGain + i) = 255;
+
+  // A blob written for a different chain length (or left over from an
+  // older layout) is ignored rather than applied to the wrong channels
+  if (eeprom_read_byte(p) != TLC5940_CALIBRATION_VERSION ||
+      eeprom_read_word((const uint16_t *)(p + 1)) != TLC5940_CHANNELS_N ||
+      eeprom_read_byte(p + 3) != TLC5940_CALIBRATION_ROWS)
+    return false;
+
+  uint8_t flags = eeprom_read_byte(p + 4);
+  p += TLC5940_CALIBRATION_HEADER_BYTES;
+
+  if (flags & TLC5940_CALIBRATION_HAS_DC) {
+#if (TLC5940_INCLUDE_DC_FUNCS)
+    for (channel_t channel = 0; channel < TLC5940_CHANNELS_N; channel++)
+      TLC5940_SetDC(channel, eeprom_read_byte(p + channel) & 0x3F);
+#endif // TLC5940_INCLUDE_DC_FUNCS
+    p += TLC5940_CHANNELS_N;
+  }
+
+  if (flags & TLC5940_CALIBRATION_HAS_GAIN) {
+    for (uint8_t row = 0; row < TLC5940_CALIBRATION_ROWS; row++)
+      for (channel_t channel = 0; channel < TLC5940_CHANNELS_N; channel++)
+        TLC5940_gain[row][TLC5940_CHANNELS_N - 1 - channel] = eeprom_read_byte(p++);
+  }
+
+  return true;
+}
+
+void TLC5940_ApplyCalibration(void) {
+  uint8_t *p = &TLC5940_GS_OUT[0];
+  const uint8_t *pGain = &TLC5940_gain[0][0];
+
+  for (gsFrame_t i = 0; i < TLC5940_FRAME_BYTES; i += 3) {
+    // value * (gain + 1) / 256, which is exact for a gain of 255
+    uint16_t v0 = TLC5940_GetPackedGS(p, 0);
+    uint16_t v1 = TLC5940_GetPackedGS(p, 1);
+    v0 -= TLC5940_ScaleGS(v0, (uint8_t)~*pGain++);
+    v1 -= TLC5940_ScaleGS(v1, (uint8_t)~*pGain++);
+    *p++ = (v0 >> 4);                                 // bits: 11 10 09 08 07 06 05 04
+    *p++ = (uint8_t)(v0 << 4) | (uint8_t)(v1 >> 8);   // bits: 03 02 01 00 11 10 09 08
+    *p++ = (uint8_t)v1;                               // bits: 07 06 05 04 03 02 01 00
+  }
+
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+  TLC5940_MarkPowerStale();
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+}
+#endif // TLC5940_ENABLE_CALIBRATION
+
+#if (TLC5940_ENABLE_MASTER_BRIGHTNESS)
+uint8_t TLC5940_gsUnscaled[TLC5940_FRAME_BYTES];
+uint8_t TLC5940_masterBrightness;
+#if (TLC5940_ENABLE_MULTIPLEXING)
+uint8_t TLC5940_rowBrightness[TLC5940_MULTIPLEX_N];
+#endif // TLC5940_ENABLE_MULTIPLEXING
+
+// Writes one row of the unscaled frame into the buffer shown next, scaled
+// by factor / 256, or just copied if factor is 255
+static void TLC5940_ScaleRow(uint8_t *pOut, const uint8_t *p, uint8_t factor) {
+  if (factor == 255) {
+    for (gsData_t i = 0; i < TLC5940_GRAYSCALE_BYTES; i++)
+      *pOut++ = *p++;
+    return;
+  }
+
+  for (gsData_t i = 0; i < TLC5940_GRAYSCALE_BYTES; i += 3) {
+    uint16_t v0 = TLC5940_ScaleGS(TLC5940_GetPackedGS(p, 0), factor);
+    uint16_t v1 = TLC5940_ScaleGS(TLC5940_GetPackedGS(p, 1), factor);
+    p += 3;
+    *pOut++ = (v0 >> 4);                                 // bits: 11 10 09 08 07 06 05 04
+    *pOut++ = (uint8_t)(v0 << 4) | (uint8_t)(v1 >> 8);   // bits: 03 02 01 00 11 10 09 08
+    *pOut++ = (uint8_t)v1;                               // bits: 07 06 05 04 03 02 01 00
+  }
+}
+
+void TLC5940_ApplyMasterBrightness(void) {
+#if (TLC5940_ENABLE_MULTIPLEXING)
+  uint8_t master = TLC5940_masterBrightness;
+  for (uint8_t row = 0; row < TLC5940_MULTIPLEX_N; row++) {
+    // ((master + 1) * (level + 1) - 1) / 256, which is exact when either is 255
+    uint8_t level = TLC5940_rowBrightness[row];
+    uint8_t factor = ((uint16_t)master * level + master + level) >> 8;
+    gsOffset_t offset = (gsOffset_t)row * TLC5940_GRAYSCALE_BYTES;
+    TLC5940_ScaleRow(&TLC5940_GS_OUT[offset], &TLC5940_gsUnscaled[offset], factor);
+  }
+#else // TLC5940_ENABLE_MULTIPLEXING
+  TLC5940_ScaleRow(&TLC5940_GS_OUT[0], &TLC5940_gsUnscaled[0], TLC5940_masterBrightness);
+#endif // TLC5940_ENABLE_MULTIPLEXING
+
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+  // The whole buffer shown next was just rewritten
+  TLC5940_MarkPowerStale();
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+}
+#endif // TLC5940_ENABLE_MASTER_BRIGHTNESS
+
+#if (TLC5940_ENABLE_PWM_SWITCHING)
+uint8_t TLC5940_pwmBits;
+uint8_t TLC5940_pwmTopPending;
+
+// Rescales a 12-bit value from 'from' to 'to' bits of resolution. Going
+// up, the top bits are repeated into the new low bits, so that the
+// largest value still maps onto the largest value.
+static inline uint16_t TLC5940_RescaleGS(uint16_t value, uint8_t from, uint8_t to) __attribute__(( always_inline ));
+static inline uint16_t TLC5940_RescaleGS(uint16_t value, uint8_t from, uint8_t to) {
+  if (to < from)
+    return value >> (uint8_t)(from - to);
+  else
+    return (value << (uint8_t)(to - from)) | (value >> (uint8_t)(from - (to - from)));
+}
+
+// Rescales the whole frame at p from 'from' to 'to' bits
+static void TLC5940_RescaleFrame(uint8_t *p, uint8_t from, uint8_t to) {
+  for (gsFrame_t i = 0; i < TLC5940_FRAME_BYTES; i += 3) {
+    uint16_t v0 = TLC5940_RescaleGS(TLC5940_GetPackedGS(p, 0), from, to);
+    uint16_t v1 = TLC5940_RescaleGS(TLC5940_GetPackedGS(p, 1), from, to);
+    *p++ = (v0 >> 4);                                 // bits: 11 10 09 08 07 06 05 04
+    *p++ = (uint8_t)(v0 << 4) | (uint8_t)(v1 >> 8);   // bits: 03 02 01 00 11 10 09 08
+    *p++ = (uint8_t)v1;                               // bits: 07 06 05 04 03 02 01 00
+  }
+}
+
+void TLC5940_SetPWMBits(uint8_t bits) {
+  uint8_t from = TLC5940_pwmBits;
+  if (bits == from)
+    return;
+
+  TLC5940_RescaleFrame(&TLC5940_GS_OUT[0], from, bits);
+#if (TLC5940_ENABLE_MASTER_BRIGHTNESS)
+  // The unscaled frame is drawn on top of from now on, so it has to be
+  // at the new resolution too
+  TLC5940_RescaleFrame(&TLC5940_GS_BACK[0], from, bits);
+#endif // TLC5940_ENABLE_MASTER_BRIGHTNESS
+
+  TLC5940_pwmBits = bits;
+  // 2^bits clock cycles between interrupts, at clk_io/64
+  TLC5940_pwmTopPending = (uint8_t)(((uint16_t)1 << (uint8_t)(bits - 6)) - 1);
+}
+#endif // TLC5940_ENABLE_PWM_SWITCHING
+
+#if (TLC5940_ENABLE_MATRIX)
+uint8_t TLC5940_matrixRows[TLC5940_MULTIPLEX_N];
+
+// Rotates TLC5940_matrixRows so that row y gets the entry of row
+// y + rows, wrapping around
+static void TLC5940_Matrix_RotateRows(uint8_t rows) {
+  uint8_t tmp[TLC5940_MULTIPLEX_N];
+  uint8_t from = rows % TLC5940_MULTIPLEX_N;
+  for (uint8_t y = 0; y < TLC5940_MULTIPLEX_N; y++) {
+    tmp[y] = TLC5940_matrixRows[from];
+    if (++from == TLC5940_MULTIPLEX_N)
+      from = 0;
+  }
+  for (uint8_t y = 0; y < TLC5940_MULTIPLEX_N; y++)
+    TLC5940_matrixRows[y] = tmp[y];
 }
 
+void TLC5940_Matrix_ScrollUp(uint8_t rows) {
+  TLC5940_Matrix_RotateRows(rows);
+}
+
+void TLC5940_Matrix_ScrollDown(uint8_t rows) {
+  TLC5940_Matrix_RotateRows(TLC5940_MULTIPLEX_N - rows % TLC5940_MULTIPLEX_N);
+}
+
+// Since gsData holds the channels in reverse order, the TLC5940 with the
+// highest x comes first in each row, so scrolling left moves the bytes of
+// each row towards its end. Every row of 'p' has pixel x taken from
+// x + chips, and then the TLC5940s at x < clearLeft and at
+// x >= TLC5940_N - clearRight cleared.
+static void TLC5940_Matrix_Shift(uint8_t *p, int16_t chips, uint8_t clearLeft, uint8_t clearRight) {
+  for (uint8_t row = 0; row < TLC5940_MULTIPLEX_N; row++) {
+    if (chips > 0) {
+      gsData_t shift = (gsData_t)24 * (uint8_t)chips;
+      for (gsData_t i = TLC5940_GRAYSCALE_BYTES; i > shift; i--)
+        *(p + i - 1) = *(p + i - 1 - shift);
+    } else if (chips < 0) {
+      gsData_t shift = (gsData_t)24 * (uint8_t)-chips;
+      for (gsData_t i = shift; i < TLC5940_GRAYSCALE_BYTES; i++)
+        *(p + i - shift) = *(p + i);
+    }
+    for (gsData_t i = 0; i < (gsData_t)24 * clearRight; i++)
+      *(p + i) = 0;
+    for (gsData_t i = TLC5940_GRAYSCALE_BYTES - (gsData_t)24 * clearLeft; i < TLC5940_GRAYSCALE_BYTES; i++)
+      *(p + i) = 0;
+    p += TLC5940_GRAYSCALE_BYTES;
+  }
+
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+  TLC5940_MarkPowerStale();
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+}
+
+#if (TLC5940_DRAW_BUFFERS_N > 1)
+// The other buffer is shown while the back buffer is scrolled, so it
+// can't be scrolled along with it. Instead, every scroll since its last
+// turn is folded into one shift and two cleared edges, and applied at
+// the start of its next turn.
+uint8_t *TLC5940_matrixPendingBuffer;
+static int16_t pendingChips;
+static uint8_t pendingClearLeft;
+static uint8_t pendingClearRight;
+
+void TLC5940_Matrix_ApplyScroll(void) {
+  if (pBack != TLC5940_matrixPendingBuffer)
+    return;
+  TLC5940_matrixPendingBuffer = 0;
+  TLC5940_Matrix_Shift(pBack, pendingChips, pendingClearLeft, pendingClearRight);
+}
+#endif // TLC5940_DRAW_BUFFERS_N
+
+// Scrolls left by 'chips' if it is positive, or right if it is negative
+static void TLC5940_Matrix_Scroll(int16_t chips) {
+  uint8_t left = (chips > 0) ? (uint8_t)chips : 0;
+  uint8_t right = (chips < 0) ? (uint8_t)-chips : 0;
+#if (TLC5940_DRAW_BUFFERS_N > 1)
+  TLC5940_Matrix_ApplyScroll();
+#endif // TLC5940_DRAW_BUFFERS_N
+  TLC5940_Matrix_Shift(&TLC5940_GS_BACK[0], chips, right, left);
+
+#if (TLC5940_DRAW_BUFFERS_N > 1)
+  uint8_t *other = (pBack == &gsData[0][0]) ? &gsDataCache[0][0] : &gsData[0][0];
+  if (TLC5940_matrixPendingBuffer != other) {
+    TLC5940_matrixPendingBuffer = other;
+    pendingChips = 0;
+    pendingClearLeft = 0;
+    pendingClearRight = 0;
+  }
+  // Scrolling left by n moves the edge of each cleared part n TLC5940s
+  // left, and scrolling right moves them right
+  pendingChips += chips;
+  pendingClearLeft = (pendingClearLeft > left) ? pendingClearLeft - left : 0;
+  pendingClearLeft += right;
+  pendingClearRight = (pendingClearRight > right) ? pendingClearRight - right : 0;
+  pendingClearRight += left;
+  if (pendingClearLeft + pendingClearRight >= TLC5940_N) {
+    pendingChips = 0;
+    pendingClearLeft = TLC5940_N;
+    pendingClearRight = 0;
+  }
+#endif // TLC5940_DRAW_BUFFERS_N
+}
+
+void TLC5940_Matrix_ScrollLeft(uint8_t chips) {
+  if (chips > TLC5940_N)
+    chips = TLC5940_N;
+  TLC5940_Matrix_Scroll(chips);
+}
+
+void TLC5940_Matrix_ScrollRight(uint8_t chips) {
+  if (chips > TLC5940_N)
+    chips = TLC5940_N;
+  TLC5940_Matrix_Scroll(-(int16_t)chips);
+}
+#endif // TLC5940_ENABLE_MATRIX
+
+#if (TLC5940_ENABLE_TWI_SLAVE)
+#define TLC5940_TWCR_ACK ((1 << TWINT) | (1 << TWEA) | (1 << TWEN) | (1 << TWIE))
+#define TLC5940_TWCR_NACK ((1 << TWINT) | (1 << TWEN) | (1 << TWIE))
+
+static gsFrame_t twiOffset; // where the next data byte goes
+static uint8_t twiOffsetBytes; // offset bytes still to come
+
+// While this returns true, the back buffer is waiting to be shown (or
+// shifted out), or every buffer is in use, so it must not be written
+static inline bool TLC5940_TWI_GetBusy(void) __attribute__(( always_inline ));
+static inline bool TLC5940_TWI_GetBusy(void) {
+#if (TLC5940_ENABLE_FRAME_QUEUE)
+  return TLC5940_GetFrameQueueFull();
+#else // TLC5940_ENABLE_FRAME_QUEUE
+  return TLC5940_GetGSUpdateFlag();
+#endif // TLC5940_ENABLE_FRAME_QUEUE
+}
+
+// The TWI hardware holds SCL low until TWINT is cleared, so the master
+// simply waits out any time this spends behind the CTC interrupt
+ISR(TWI_vect) {
+  uint8_t twcr = TLC5940_TWCR_ACK;
+
+  switch (TW_STATUS) {
+  case TW_SR_SLA_ACK:
+    twiOffset = 0;
+    twiOffsetBytes = TLC5940_TWI_OFFSET_BYTES;
+    if (TLC5940_TWI_GetBusy())
+      twcr = TLC5940_TWCR_NACK; // the offset byte, and so the whole write
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+    else
+      twiPowerStale |= (uint8_t)((uint8_t)1 << TLC5940_GetBackIndex());
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+    break;
+  case TW_SR_DATA_ACK:
+    if (twiOffsetBytes) {
+#if (TLC5940_TWI_OFFSET_BYTES == 2)
+      twiOffset = (twiOffset << 8) | TWDR;
+#else // TLC5940_TWI_OFFSET_BYTES
+      twiOffset = TWDR;
+#endif // TLC5940_TWI_OFFSET_BYTES
+      if (--twiOffsetBytes == 0 && twiOffset >= TLC5940_FRAME_BYTES)
+        twcr = TLC5940_TWCR_NACK;
+    } else {
+      TLC5940_GS_BACK[twiOffset] = TWDR;
+      if (++twiOffset == TLC5940_FRAME_BYTES)
+        twcr = TLC5940_TWCR_NACK; // that was the last byte that fits
+    }
+    break;
+  case TW_SR_GCALL_ACK:
+    // The general call address alone commits nothing, until its command
+    // byte turns out to be ours
+    break;
+  case TW_SR_GCALL_DATA_ACK:
+    // Every slave sees the command byte at the same moment
+    if (TWDR == TLC5940_TWI_COMMIT && !TLC5940_TWI_GetBusy()) {
+#if (TLC5940_ENABLE_FRAME_QUEUE)
+      TLC5940_QueueFrame(TLC5940_ticks);
+#else // TLC5940_ENABLE_FRAME_QUEUE
+      TLC5940_SetGSUpdateFlag();
+#endif // TLC5940_ENABLE_FRAME_QUEUE
+    }
+    twcr = TLC5940_TWCR_NACK; // a command is only ever one byte long
+    break;
+  case TW_ST_SLA_ACK:
+  case TW_ST_DATA_ACK:
+    // Nothing can be read back, so reads just see 0xFF
+    TWDR = 0xFF;
+    twcr = TLC5940_TWCR_NACK;
+    break;
+  case TW_BUS_ERROR:
+    twcr = TLC5940_TWCR_ACK | (1 << TWSTO);
+    break;
+  default:
+    // A stop, a NACKed byte, or the end of a read: TWEA has to be set
+    // again, or this slave would stop answering to its address
+    break;
+  }
+
+  TWCR = twcr;
+}
+#endif // TLC5940_ENABLE_TWI_SLAVE
+
+#if (TLC5940_ENABLE_AUDIO)
+// How far each band's level may fall per block
+#define TLC5940_AUDIO_DECAY 128
+
+// sin(2 * pi * k / 128) in Q15, for k = 0 through 95, so that the cosine
+// is 32 entries further on. A 64 point FFT uses every other entry.
+static const int16_t audioSine[96] PROGMEM = {
+       0,   1608,   3212,   4808,   6393,   7962,   9512,  11039,
+   12539,  14010,  15446,  16846,  18204,  19519,  20787,  22005,
+   23170,  24279,  25329,  26319,  27245,  28105,  28898,  29621,
+   30273,  30852,  31356,  31785,  32137,  32412,  32609,  32728,
+   32767,  32728,  32609,  32412,  32137,  31785,  31356,  30852,
+   30273,  29621,  28898,  28105,  27245,  26319,  25329,  24279,
+   23170,  22005,  20787,  19519,  18204,  16846,  15446,  14010,
+   12539,  11039,   9512,   7962,   6393,   4808,   3212,   1608,
+       0,  -1608,  -3212,  -4808,  -6393,  -7962,  -9512, -11039,
+  -12539, -14010, -15446, -16846, -18204, -19519, -20787, -22005,
+  -23170, -24279, -25329, -26319, -27245, -28105, -28898, -29621,
+  -30273, -30852, -31356, -31785, -32137, -32412, -32609, -32728
+};
+
+// First bin of each band, followed by the bin at half the sample rate
+static const uint8_t audioBandEdges[TLC5940_AUDIO_BANDS_N + 1] PROGMEM = {
+#if (TLC5940_AUDIO_FFT_N == 64)
+  1, 2, 3, 4, 6, 9, 14, 21, 32
+#else // TLC5940_AUDIO_FFT_N
+  1, 2, 3, 5, 8, 13, 21, 34, 64
+#endif // TLC5940_AUDIO_FFT_N
+};
+
+uint16_t TLC5940_audioLevel[TLC5940_AUDIO_BANDS_N];
+
+// The ADC interrupt fills one block while the main loop reads the other
+static uint8_t audioSamples[2][TLC5940_AUDIO_FFT_N];
+static volatile uint8_t audioFill; // index of the next sample
+static volatile uint8_t audioBuf; // block being filled
+static volatile bool audioReady; // the other block is full
+
+static int16_t audioRe[TLC5940_AUDIO_FFT_N];
+static int16_t audioIm[TLC5940_AUDIO_FFT_N];
+
+ISR(ADC_vect) {
+  uint8_t i = audioFill;
+  audioSamples[audioBuf][i] = ADCH;
+  if (++i == TLC5940_AUDIO_FFT_N) {
+    i = 0;
+    audioBuf ^= 1;
+    audioReady = true;
+  }
+  audioFill = i;
+}
+
+// Returns sin(2 * pi * k / 128) in Q15 for any k
+static inline int16_t TLC5940_AudioSine(uint8_t k) __attribute__(( always_inline ));
+static inline int16_t TLC5940_AudioSine(uint8_t k) {
+  k &= 127;
+  if (k >= 96)
+    return -(int16_t)pgm_read_word(&audioSine[k - 64]);
+  return pgm_read_word(&audioSine[k]);
+}
+
+static inline int16_t TLC5940_MulQ15(int16_t a, int16_t b) __attribute__(( always_inline ));
+static inline int16_t TLC5940_MulQ15(int16_t a, int16_t b) {
+  return (int16_t)(((int32_t)a * b) >> 15);
+}
+
+void TLC5940_Audio_FFT(int16_t *re, int16_t *im) {
+  // Bit-reversal permutation
+  for (uint8_t i = 1, j = 0; i < TLC5940_AUDIO_FFT_N; i++) {
+    uint8_t bit = TLC5940_AUDIO_FFT_N >> 1;
+    for (; j & bit; bit >>= 1)
+      j ^= bit;
+    j ^= bit;
+    if (i < j) {
+      int16_t tmp = re[i];
+      re[i] = re[j];
+      re[j] = tmp;
+      tmp = im[i];
+      im[i] = im[j];
+      im[j] = tmp;
+    }
+  }
+
+  for (uint8_t half = 1; half < TLC5940_AUDIO_FFT_N; half <<= 1) {
+    uint8_t span = half << 1;
+    uint8_t stride = 64 / half;
+    for (uint8_t k = 0; k < half; k++) {
+      // w = exp(-2 * pi * i * k / (2 * half))
+      int16_t wr = TLC5940_AudioSine(k * stride + 32);
+      int16_t wi = -TLC5940_AudioSine(k * stride);
+      for (uint8_t i = k; i < TLC5940_AUDIO_FFT_N; i += span) {
+        uint8_t j = i + half;
+        int16_t tr = TLC5940_MulQ15(re[j], wr) - TLC5940_MulQ15(im[j], wi);
+        int16_t ti = TLC5940_MulQ15(re[j], wi) + TLC5940_MulQ15(im[j], wr);
+        re[j] = (re[i] - tr) >> 1;
+        im[j] = (im[i] - ti) >> 1;
+        re[i] = (re[i] + tr) >> 1;
+        im[i] = (im[i] + ti) >> 1;
+      }
+    }
+  }
+}
+
+// Returns log2(value) with 8 fractional bits, or 0 for 0
+static uint16_t TLC5940_Log2Q8(uint16_t value) {
+  if (value == 0)
+    return 0;
+  uint8_t exponent = 15;
+  while (!(value & 0x8000)) {
+    value <<= 1;
+    exponent--;
+  }
+  return ((uint16_t)exponent << 8) | (uint8_t)(value >> 7);
+}
+
+bool TLC5940_Audio_Process(void) {
+  if (!audioReady)
+    return false;
+  audioReady = false;
+  __asm__ volatile ("" ::: "memory"); // the block must be read afterwards
+  const uint8_t *p = audioSamples[audioBuf ^ 1];
+
+  // The input is biased at about half the supply, so the block's mean is
+  // taken out, and the rest scaled up to within +/-8192 and shaped by a
+  // Hann window, (1 - cos(2 * pi * i / N)) / 2, to keep a loud band from
+  // leaking into all of the others
+  uint16_t sum = 0;
+  for (uint8_t i = 0; i < TLC5940_AUDIO_FFT_N; i++)
+    sum += p[i];
+  uint8_t mean = sum >> TLC5940_AUDIO_FFT_LOG2N;
+  for (uint8_t i = 0; i < TLC5940_AUDIO_FFT_N; i++) {
+    int16_t window = (uint16_t)((uint16_t)32767 - (uint16_t)TLC5940_AudioSine(i * (128 / TLC5940_AUDIO_FFT_N) + 32)) >> 1;
+    audioRe[i] = TLC5940_MulQ15(((int16_t)p[i] - mean) * 32, window);
+    audioIm[i] = 0;
+  }
+
+  TLC5940_Audio_FFT(audioRe, audioIm);
+
+  uint8_t bin = pgm_read_byte(&audioBandEdges[0]);
+  for (uint8_t band = 0; band < TLC5940_AUDIO_BANDS_N; band++) {
+    uint8_t end = pgm_read_byte(&audioBandEdges[band + 1]);
+    uint16_t peak = 0;
+    for (; bin < end; bin++) {
+      // |z| ~ max(|re|, |im|) + min(|re|, |im|) / 2
+      uint16_t a = (audioRe[bin] < 0) ? -audioRe[bin] : audioRe[bin];
+      uint16_t b = (audioIm[bin] < 0) ? -audioIm[bin] : audioIm[bin];
+      uint16_t magnitude = (a > b) ? a + (b >> 1) : b + (a >> 1);
+      if (magnitude > peak)
+        peak = magnitude;
+    }
+
+    // A full scale sine wave reaches about 2^11 after the window, so the
+    // log is shifted up by three octaves to use the whole grayscale range
+    uint16_t level = 0;
+    if (peak) {
+      level = TLC5940_Log2Q8(peak) + 768;
+      if (level > 4095)
+        level = 4095;
+    }
+    uint16_t old = TLC5940_audioLevel[band];
+    if (old > level + TLC5940_AUDIO_DECAY)
+      level = old - TLC5940_AUDIO_DECAY;
+    TLC5940_audioLevel[band] = level;
+  }
+
+  return true;
+}
+
+#if (TLC5940_ENABLE_MULTIPLEXING)
+void TLC5940_Audio_SetBands(uint8_t row) {
+#else // TLC5940_ENABLE_MULTIPLEXING
+void TLC5940_Audio_SetBands(void) {
+#endif // TLC5940_ENABLE_MULTIPLEXING
+  for (channel_t channel = 0; channel < TLC5940_CHANNELS_N; channel++) {
+    uint16_t level = TLC5940_audioLevel[(uint16_t)channel * TLC5940_AUDIO_BANDS_N / TLC5940_CHANNELS_N];
+#if (TLC5940_ENABLE_MULTIPLEXING)
+    TLC5940_SetGS(row, channel, level);
+#else // TLC5940_ENABLE_MULTIPLEXING
+    TLC5940_SetGS(channel, level);
+#endif // TLC5940_ENABLE_MULTIPLEXING
+  }
+}
+#endif // TLC5940_ENABLE_AUDIO
+
+#if (TLC5940_ENABLE_SCHEDULER)
+TLC5940_Task_t TLC5940_tasks[TLC5940_TASKS_N];
+
+uint16_t TLC5940_GetTime(void) {
+  uint8_t sreg = SREG;
+  cli();
+  uint8_t count = TLC5940_CTC_TCNT;
+  uint16_t ticks = TLC5940_ticks;
+  if (TLC5940_CTC_TIFR & (1 << TLC5940_CTC_OCF)) {
+    // The CTC interrupt is pending, so TLC5940_ticks is one behind, and
+    // the count has to be read again in case it wrapped after the first read
+    count = TLC5940_CTC_TCNT;
+    ticks++;
+  }
+  SREG = sreg;
+  return ticks * (uint16_t)(TLC5940_CTC_TOP + 1) + count;
+}
+
+void TLC5940_SetTask(uint8_t slot, TLC5940_TaskFunc_t run, uint16_t budget) {
+  TLC5940_Task_t *task = &TLC5940_tasks[slot];
+  task->run = run;
+  task->budget = budget;
+  task->estimate = budget;
+  task->cost = 0;
+  task->total = 0;
+  task->runs = 0;
+  task->deferrals = 0;
+  task->overruns = 0;
+}
+
+uint8_t TLC5940_RunTasks(uint16_t deadline) {
+  uint8_t deferred = 0;
+
+  for (uint8_t slot = 0; slot < TLC5940_TASKS_N; slot++) {
+    TLC5940_Task_t *task = &TLC5940_tasks[slot];
+    if (!task->run)
+      continue;
+
+    uint16_t start = TLC5940_GetTime();
+    if ((int16_t)(deadline - start) < (int16_t)task->estimate) {
+      // Doesn't fit in what is left of this frame. Each deferral halves
+      // how far an overrun raised the estimate, so that one slow run
+      // can't lock a task out for good. The half is rounded up, so the
+      // estimate settles on the budget rather than one tick above it.
+      uint16_t excess = task->estimate - task->budget;
+      task->estimate -= excess - (excess >> 1);
+      task->deferrals++;
+      deferred++;
+      continue;
+    }
+
+    task->run();
+
+    uint16_t cost = TLC5940_GetTime() - start;
+    task->cost = cost;
+    task->total += cost;
+    task->runs++;
+    if (cost > task->budget) {
+      task->overruns++;
+      task->estimate = cost;
+    } else {
+      task->estimate = task->budget;
+    }
+  }
+
+  return deferred;
+}
+#endif // TLC5940_ENABLE_SCHEDULER
+
+#if (TLC5940_ENABLE_TRACE)
+TLC5940_TraceEntry_t TLC5940_trace[TLC5940_TRACE_N];
+uint8_t TLC5940_traceHead;
+uint8_t TLC5940_traceTick;
+bool TLC5940_traceFrozen;
+#if (TLC5940_ENABLE_MULTIPLEXING)
+// Set on a page flip, so the next interrupt records latching its first row
+static bool traceNewFrame;
+#endif // TLC5940_ENABLE_MULTIPLEXING
+
+void TLC5940_TraceDump(void (*put)(uint8_t)) {
+  TLC5940_traceFrozen = true;
+  __asm__ volatile ("" ::: "memory");
+
+  put('T');
+  put('R');
+  put(TLC5940_TRACE_N);
+  put(TLC5940_CTC_TOP);
+#if (TLC5940_ENABLE_MULTIPLEXING)
+  put(TLC5940_MULTIPLEX_N);
+#else // TLC5940_ENABLE_MULTIPLEXING
+  put(0);
+#endif // TLC5940_ENABLE_MULTIPLEXING
+
+  // The oldest entry is the one about to be overwritten
+  uint8_t i = TLC5940_traceHead;
+  do {
+    put(TLC5940_trace[i].tick);
+    put(TLC5940_trace[i].event);
+    i = (i + 1) & (TLC5940_TRACE_N - 1);
+  } while (i != TLC5940_traceHead);
+
+  __asm__ volatile ("" ::: "memory");
+  TLC5940_traceFrozen = false;
+}
+
+// Counts the interrupt, and records what it just did to the outputs
+static inline void TLC5940_TraceTick(void) __attribute__(( always_inline ));
+static inline void TLC5940_TraceTick(void) {
+  if (++TLC5940_traceTick == 0)
+    TLC5940_TraceFromISR(TLC5940_TRACE_WRAP);
+#if (TLC5940_ENABLE_MULTIPLEXING)
+  // The row lit by this interrupt is the one shifted out by the last one
+  uint8_t lit = (TLC5940_row ? TLC5940_row : TLC5940_MULTIPLEX_N) - 1;
+#if (TLC5940_ENABLE_TRACE == 2)
+  TLC5940_TraceFromISR(TLC5940_TRACE_BLANK | lit);
+#endif // TLC5940_ENABLE_TRACE
+  if (traceNewFrame) {
+    traceNewFrame = false;
+    TLC5940_TraceFromISR(TLC5940_TRACE_XLAT | lit);
+  }
+#endif // TLC5940_ENABLE_MULTIPLEXING
+}
+
+// Records a page flip (or a frame shifted out, when not multiplexing)
+static inline void TLC5940_TraceFlip(uint8_t queued) __attribute__(( always_inline ));
+static inline void TLC5940_TraceFlip(uint8_t queued) {
+  TLC5940_TraceFromISR(TLC5940_TRACE_FLIP | queued);
+#if (TLC5940_ENABLE_MULTIPLEXING)
+  traceNewFrame = true;
+#endif // TLC5940_ENABLE_MULTIPLEXING
+}
+#endif // TLC5940_ENABLE_TRACE
+
+#if (TLC5940_ENABLE_SYNC)
+// Counts from the leader's compare match until a follower's INT0 handler
+// gets to its timer: the leader's ISR prologue and page flip, plus the
+// follower's interrupt response and prologue, a little over 64 clocks
+#define TLC5940_SYNC_LATENCY 1
+
+// Number of CTC interrupts left until the one that may flip, or 0 if no
+// flip has been announced on the sync line
+static uint8_t syncCountdown;
+
+#if (TLC5940_SYNC_LEADER == 0 && TLC5940_SYNC_PHASE)
+// Set by the CTC interrupt if the sync edge arrived while it was running
+static bool syncHeldOff;
+#endif // TLC5940_SYNC_LEADER
+
+// Called once per CTC interrupt, returns true for the interrupt that an
+// announced flip belongs to
+static inline bool TLC5940_SyncFlip(void) __attribute__(( always_inline ));
+static inline bool TLC5940_SyncFlip(void) {
+  uint8_t n = syncCountdown;
+  if (n == 0)
+    return false;
+  syncCountdown = --n;
+  return (n == 0);
+}
+
+// Called at the end of every CTC interrupt
+static inline void TLC5940_SyncEnd(void) __attribute__(( always_inline ));
+static inline void TLC5940_SyncEnd(void) {
+#if (TLC5940_SYNC_LEADER)
+  // The pulse lasts as long as the data takes to shift out, which is
+  // long enough for every follower to see it
+  setLow(SYNC_PORT, SYNC_PIN);
+#elif (TLC5940_SYNC_PHASE)
+  if (EIFR & (1 << INTF0))
+    syncHeldOff = true;
+#endif // TLC5940_SYNC_LEADER
+}
+
+#if (TLC5940_SYNC_LEADER == 0)
+// The leader raises the sync line early in the interrupt before the one
+// that flips, so this runs in step with the leader's compare match. At
+// that point, the leader's next interrupt is the one that flips (on row
+// 0 when multiplexing), so that is made true here as well.
+ISR(INT0_vect) {
+#if (TLC5940_SYNC_PHASE)
+  // The edge reaches this point about TLC5940_SYNC_LATENCY counts after
+  // the leader's compare match, so restarting the timer from there puts
+  // both compare matches within a count of each other. If our own CTC
+  // interrupt held this one off, the edge came while it was running, and
+  // how long ago is unknown. We are ahead of the leader by less than that
+  // ISR, so the timer is only slewed back by one count, until the edge
+  // arrives ahead of our compare match again.
+  if (syncHeldOff) {
+    syncHeldOff = false;
+    TLC5940_CTC_TCNT--;
+  } else {
+    TLC5940_CTC_TCNT = TLC5940_SYNC_LATENCY;
+  }
+#endif // TLC5940_SYNC_PHASE
+
+  // A compare match that is already pending belongs with the leader's
+  // current interrupt, so the flip is one interrupt further away
+  bool pending = TLC5940_CTC_TIFR & (1 << TLC5940_CTC_OCF);
+
+#if (TLC5940_ENABLE_MULTIPLEXING && TLC5940_MULTIPLEX_N > 1)
+  uint8_t row = pending ? TLC5940_MULTIPLEX_N - 1 : 0;
+  if (TLC5940_row != row) {
+    // Jump to the leader's row. The lit row is moved along with it, so
+    // that the ISR's toggles keep exactly one row on. Until the next
+    // interrupt, it shows whatever row was shifted out last.
+    MULTIPLEX_INPUT = toggleRows[TLC5940_row + TLC5940_MULTIPLEX_N] & ~TLC5940_TR_EXTRAS;
+    MULTIPLEX_INPUT = toggleRows[row + TLC5940_MULTIPLEX_N] & ~TLC5940_TR_EXTRAS;
+    TLC5940_row = row;
+  }
+#endif // TLC5940_ENABLE_MULTIPLEXING
+
+  syncCountdown = pending ? 2 : 1;
+}
+#endif // TLC5940_SYNC_LEADER
+#endif // TLC5940_ENABLE_SYNC
+
 #if (TLC5940_ENABLE_MULTIPLEXING == 0)
 #if (TLC5940_USE_GPIOR0 == 0)
 bool xlatNeedsPulse;
 #endif // TLC5940_USE_GPIOR0
 #endif // TLC5940_ENABLE_MULTIPLEXING
 
+#if (TLC5940_UNROLL_SHIFT_LOOPS)
+// One TLC5940's worth of grayscale data, one byte at a time
+#define TLC5940_TX_8(p) do {                      \
+                          TLC5940_TX_NEXT(p);     \
+                          TLC5940_TX_NEXT(p);     \
+                          TLC5940_TX_NEXT(p);     \
+                          TLC5940_TX_NEXT(p);     \
+                          TLC5940_TX_NEXT(p);     \
+                          TLC5940_TX_NEXT(p);     \
+                          TLC5940_TX_NEXT(p);     \
+                          TLC5940_TX_NEXT(p);     \
+                        } while (0)
+#define TLC5940_TX_24(p) do {                     \
+                           TLC5940_TX_8(p);       \
+                           TLC5940_TX_8(p);       \
+                           TLC5940_TX_8(p);       \
+                         } while (0)
+#endif // TLC5940_UNROLL_SHIFT_LOOPS
+
+// Shifts out one row (or the only row) of grayscale data starting at p
+static inline void TLC5940_ShiftOut(const uint8_t *p) __attribute__(( always_inline ));
+static inline void TLC5940_ShiftOut(const uint8_t *p) {
+#if (TLC5940_UNROLL_SHIFT_LOOPS == 0)
+  gsData_t i = TLC5940_GRAYSCALE_BYTES + 1;
+  while (--i)
+    TLC5940_TX(*p++);
+#else // TLC5940_UNROLL_SHIFT_LOOPS
+  // The first TLC5940 is split up, since its first byte has no byte
+  // before it to load it under
+  TLC5940_TX_FIRST(p);
+  TLC5940_TX_8(p);
+  TLC5940_TX_8(p);
+  TLC5940_TX_NEXT(p);
+  TLC5940_TX_NEXT(p);
+  TLC5940_TX_NEXT(p);
+  TLC5940_TX_NEXT(p);
+  TLC5940_TX_NEXT(p);
+  TLC5940_TX_NEXT(p);
+  TLC5940_TX_NEXT(p);
+#if (TLC5940_UNROLL_SHIFT_LOOPS == 1)
+  // Only one loop iteration per TLC5940, with an 8-bit counter
+  for (uint8_t chip = TLC5940_N - 1; chip; chip--)
+    TLC5940_TX_24(p);
+#else // TLC5940_UNROLL_SHIFT_LOOPS
+#if (TLC5940_N > 16)
+#error "TLC5940_UNROLL_SHIFT_LOOPS = 2 supports up to 16 TLC5940s, use 1 instead"
+#endif // TLC5940_N
+#if (TLC5940_N > 1)
+  TLC5940_TX_24(p);
+#endif // TLC5940_N
+#if (TLC5940_N > 2)
+  TLC5940_TX_24(p);
+#endif // TLC5940_N
+#if (TLC5940_N > 3)
+  TLC5940_TX_24(p);
+#endif // TLC5940_N
+#if (TLC5940_N > 4)
+  TLC5940_TX_24(p);
+#endif // TLC5940_N
+#if (TLC5940_N > 5)
+  TLC5940_TX_24(p);
+#endif // TLC5940_N
+#if (TLC5940_N > 6)
+  TLC5940_TX_24(p);
+#endif // TLC5940_N
+#if (TLC5940_N > 7)
+  TLC5940_TX_24(p);
+#endif // TLC5940_N
+#if (TLC5940_N > 8)
+  TLC5940_TX_24(p);
+#endif // TLC5940_N
+#if (TLC5940_N > 9)
+  TLC5940_TX_24(p);
+#endif // TLC5940_N
+#if (TLC5940_N > 10)
+  TLC5940_TX_24(p);
+#endif // TLC5940_N
+#if (TLC5940_N > 11)
+  TLC5940_TX_24(p);
+#endif // TLC5940_N
+#if (TLC5940_N > 12)
+  TLC5940_TX_24(p);
+#endif // TLC5940_N
+#if (TLC5940_N > 13)
+  TLC5940_TX_24(p);
+#endif // TLC5940_N
+#if (TLC5940_N > 14)
+  TLC5940_TX_24(p);
+#endif // TLC5940_N
+#if (TLC5940_N > 15)
+  TLC5940_TX_24(p);
+#endif // TLC5940_N
+#endif // TLC5940_UNROLL_SHIFT_LOOPS
+  TLC5940_TX_LAST();
+#endif // TLC5940_UNROLL_SHIFT_LOOPS
+}
+
+#if (TLC5940_ENABLE_STATUS_READBACK)
+uint8_t TLC5940_statusData[TLC5940_GRAYSCALE_BYTES];
+volatile uint8_t TLC5940_statusState;
+
+// Shifts out one row of grayscale data while storing the SID that the
+// TLC5940s shift back in over MISO. The only added cost over
+// TLC5940_TX() is reading SPDR and storing it, once per byte. With
+// TLC5940_UNROLL_SHIFT_LOOPS = 1 or 2, each byte is loaded while the one
+// before it is on the wire, as in TLC5940_ShiftOut(), but the loop isn't
+// unrolled, since its overhead is hidden behind the wire time anyway.
+static inline void TLC5940_ShiftOutAndCapture(const uint8_t *p) __attribute__(( always_inline ));
+static inline void TLC5940_ShiftOutAndCapture(const uint8_t *p) {
+  uint8_t *pStatus = TLC5940_statusData;
+#if (TLC5940_UNROLL_SHIFT_LOOPS == 0)
+  gsData_t i = TLC5940_GRAYSCALE_BYTES + 1;
+  while (--i)
+    TLC5940_TXRX(*p++, *pStatus++);
+#else // TLC5940_UNROLL_SHIFT_LOOPS
+  TLC5940_TXRX_FIRST(p);
+  gsData_t i = TLC5940_GRAYSCALE_BYTES;
+  while (--i)
+    TLC5940_TXRX_NEXT(p, *pStatus++);
+  TLC5940_TXRX_LAST(*pStatus);
+#endif // TLC5940_UNROLL_SHIFT_LOOPS
+  TLC5940_statusState = TLC5940_STATUS_READY;
+}
+#endif // TLC5940_ENABLE_STATUS_READBACK
+
+#if (TLC5940_ENABLE_RENDER)
+// Renders and shifts out the grayscale data of every chip, two outputs
+// (three bytes) at a time, in the same order as they would be stored in
+// gsData
+static inline void TLC5940_ShiftOutRendered(void) __attribute__(( always_inline ));
+static inline void TLC5940_ShiftOutRendered(void) {
+  uint8_t chip = TLC5940_N;
+  do {
+    chip--;
+    uint8_t output = 16;
+    do {
+      uint16_t v0 = TLC5940_Render(chip, --output);
+      uint16_t v1 = TLC5940_Render(chip, --output);
+      TLC5940_TX(v0 >> 4);                                 // bits: 11 10 09 08 07 06 05 04
+      TLC5940_TX((uint8_t)(v0 << 4) | (uint8_t)(v1 >> 8)); // bits: 03 02 01 00 11 10 09 08
+      TLC5940_TX((uint8_t)v1);                             // bits: 07 06 05 04 03 02 01 00
+    } while (output);
+  } while (chip);
+}
+#endif // TLC5940_ENABLE_RENDER
+
 #if (TLC5940_INCLUDE_DEFAULT_ISR)
+#if (TLC5940_ENABLE_PWM_SWITCHING)
+#if (TLC5940_ISR_CTC_TIMER == 0)
+#define TLC5940_CTC_OCR OCR0A
+#else // TLC5940_ISR_CTC_TIMER
+#define TLC5940_CTC_OCR OCR2A
+#endif // TLC5940_ISR_CTC_TIMER
+#endif // TLC5940_ENABLE_PWM_SWITCHING
+
 // Interrupt gets called every (TLC5940_CTC_TOP + 1) * 64 clock cycles
 ISR(TLC5940_TIMER_COMPA_vect) {
+#if (TLC5940_ENABLE_PWM_SWITCHING)
+  // The interval to switch to once the data being shifted out is latched
+  static uint8_t pwmTop;
+#endif // TLC5940_ENABLE_PWM_SWITCHING
 #if (TLC5940_ENABLE_MULTIPLEXING)
 
   static uint8_t *pFront = &gsData[0][0]; // read pointer
@@ -494,19 +2382,88 @@ ISR(TLC5940_TIMER_COMPA_vect) {
   TLC5940_ToggleXLAT_BLANK();
   // We now have (TLC5940_CTC_TOP + 1) * 64 clocks to send data for next cycle
 
+#if (TLC5940_ENABLE_PWM_SWITCHING)
+  // Row 0 of a frame at a new resolution was just latched. The counter is
+  // still near 0, so the new TOP takes effect for this very interval.
+  if (pwmTop) {
+    TLC5940_CTC_OCR = pwmTop;
+    pwmTop = 0;
+  }
+#endif // TLC5940_ENABLE_PWM_SWITCHING
+
+#if (TLC5940_ENABLE_TRACE)
+  TLC5940_TraceTick();
+#endif // TLC5940_ENABLE_TRACE
+
+#if (TLC5940_ENABLE_FRAME_QUEUE)
+  uint16_t ticks = TLC5940_ticks + 1;
+  TLC5940_ticks = ticks;
+
+  // Only promote a queued frame if we finished displaying all rows, and
+  // its tick arrives when the data shifted out below gets latched
+  if (TLC5940_row == 0) {
+    uint8_t next = TLC5940_frameShown + 1;
+    if (next == TLC5940_FRAME_QUEUE_N)
+      next = 0;
+    if (next != TLC5940_frameHead && (int16_t)(ticks + 1 - TLC5940_frames[next].tick) >= 0) {
+      pFront = TLC5940_frames[next].buf;
+      TLC5940_frameShown = next;
+#if (TLC5940_ENABLE_TRACE)
+      TLC5940_TraceFlip(1);
+#endif // TLC5940_ENABLE_TRACE
+    }
+  }
+#else // TLC5940_ENABLE_FRAME_QUEUE
+#if (TLC5940_ENABLE_TICKS)
+  TLC5940_ticks++;
+#endif // TLC5940_ENABLE_TICKS
+
+#if (TLC5940_ENABLE_SYNC)
+  // Only page-flip on the row 0 interrupt announced on the sync line, so
+  // that every board flips on the same tick
+  if (TLC5940_SyncFlip() && TLC5940_row == 0 && TLC5940_GetGSUpdateFlag()) {
+#else // TLC5940_ENABLE_SYNC
   // Only page-flip if new data is ready and we finished displaying all rows
   if (TLC5940_GetGSUpdateFlag() && TLC5940_row == 0) {
+#endif // TLC5940_ENABLE_SYNC
     uint8_t *tmp = pFront;
     pFront = pBack;
     pBack = tmp;
+#if (TLC5940_ENABLE_PWM_SWITCHING)
+    pwmTop = TLC5940_pwmTopPending;
+    TLC5940_pwmTopPending = 0;
+#endif // TLC5940_ENABLE_PWM_SWITCHING
+#if (TLC5940_ENABLE_MATRIX)
+    for (uint8_t y = 0; y < TLC5940_MULTIPLEX_N; y++)
+      TLC5940_matrixShownRows[y] = TLC5940_matrixRows[y];
+#endif // TLC5940_ENABLE_MATRIX
     TLC5940_ClearGSUpdateFlag();
     __asm__ volatile ("" ::: "memory"); // ensure pBack gets re-read
+#if (TLC5940_ENABLE_TRACE)
+    TLC5940_TraceFlip(0);
+#endif // TLC5940_ENABLE_TRACE
   }
+#if (TLC5940_ENABLE_SYNC && TLC5940_SYNC_LEADER)
+  // Announce new data one interrupt ahead of the flip, giving followers a
+  // whole interrupt to line up with us
+  if (TLC5940_row == TLC5940_MULTIPLEX_N - 1 && TLC5940_GetGSUpdateFlag()) {
+    setHigh(SYNC_PORT, SYNC_PIN);
+    syncCountdown = 1;
+  }
+#endif // TLC5940_ENABLE_SYNC
+#endif // TLC5940_ENABLE_FRAME_QUEUE
 
+#if (TLC5940_ENABLE_MATRIX)
+  gsOffset_t offset = (gsOffset_t)TLC5940_GRAYSCALE_BYTES * TLC5940_matrixShownRows[TLC5940_row];
+#else // TLC5940_ENABLE_MATRIX
   gsOffset_t offset = (gsOffset_t)TLC5940_GRAYSCALE_BYTES * TLC5940_row;
-  gsData_t i = TLC5940_GRAYSCALE_BYTES + 1;
-  while (--i) // loop over gsData[TLC5940_row][i] or gsDataCache[TLC5940_row][i]
-    TLC5940_TX(*(pFront + offset++));
+#endif // TLC5940_ENABLE_MATRIX
+#if (TLC5940_ENABLE_STATUS_READBACK)
+  if (TLC5940_statusState == TLC5940_STATUS_REQUESTED) {
+    TLC5940_ShiftOutAndCapture(pFront + offset);
+  } else
+#endif // TLC5940_ENABLE_STATUS_READBACK
+  TLC5940_ShiftOut(pFront + offset); // gsData[TLC5940_row] or gsDataCache[TLC5940_row]
 
   // Advance the row in the most efficient way
 #if ((TLC5940_MULTIPLEX_N & (TLC5940_MULTIPLEX_N - 1)) == 0)
@@ -516,6 +2473,10 @@ ISR(TLC5940_TIMER_COMPA_vect) {
     TLC5940_row = 0;
 #endif // TLC5940_MULTIPLEX_N
 
+#if (TLC5940_ENABLE_SYNC)
+  TLC5940_SyncEnd();
+#endif // TLC5940_ENABLE_SYNC
+
 #else // TLC5940_ENABLE_MULTIPLEXING
 
   // The following if/else block has been carefully structured to
@@ -527,18 +2488,100 @@ ISR(TLC5940_TIMER_COMPA_vect) {
     TLC5940_ToggleBLANK_XLAT(); // high
     TLC5940_RespectSetupAndHoldTimes();
     TLC5940_ToggleXLAT_BLANK(); // low
+#if (TLC5940_ENABLE_PWM_SWITCHING)
+    // A frame at a new resolution was just latched. The counter is still
+    // near 0, so the new TOP takes effect for this very interval.
+    if (pwmTop) {
+      TLC5940_CTC_OCR = pwmTop;
+      pwmTop = 0;
+    }
+#endif // TLC5940_ENABLE_PWM_SWITCHING
+#if (TLC5940_ENABLE_TRACE)
+    TLC5940_TraceTick();
+    TLC5940_TraceFromISR(TLC5940_TRACE_XLAT);
+#endif // TLC5940_ENABLE_TRACE
   } else {
+#if (TLC5940_HARDWARE_BLANK == 0)
     togglePin(BLANK_INPUT, BLANK_PIN); // high
     TLC5940_RespectSetupAndHoldTimes();
     togglePin(BLANK_INPUT, BLANK_PIN); // low
+#endif // TLC5940_HARDWARE_BLANK
+#if (TLC5940_ENABLE_TRACE)
+    TLC5940_TraceTick();
+#if (TLC5940_ENABLE_TRACE == 2)
+    TLC5940_TraceFromISR(TLC5940_TRACE_BLANK);
+#endif // TLC5940_ENABLE_TRACE
+#endif // TLC5940_ENABLE_TRACE
   }
   // We now have (TLC5940_CTC_TOP + 1) * 64 clocks to send data for next cycle
 
+#if (TLC5940_ENABLE_FRAME_QUEUE)
+  uint16_t ticks = TLC5940_ticks + 1;
+  TLC5940_ticks = ticks;
+
+  // Data shifted out now is latched by the next interrupt, so a frame is
+  // shifted out one tick before the tick it was queued for
+  uint8_t next = TLC5940_frameShown + 1;
+  if (next == TLC5940_FRAME_QUEUE_N)
+    next = 0;
+  if (next != TLC5940_frameHead && (int16_t)(ticks + 1 - TLC5940_frames[next].tick) >= 0) {
+    const uint8_t *p = TLC5940_frames[next].buf;
+#if (TLC5940_ENABLE_STATUS_READBACK)
+    if (TLC5940_statusState == TLC5940_STATUS_REQUESTED)
+      TLC5940_ShiftOutAndCapture(p);
+    else
+#endif // TLC5940_ENABLE_STATUS_READBACK
+    TLC5940_ShiftOut(p);
+    TLC5940_frameShown = next;
+    TLC5940_SetXLATNeedsPulseFlag();
+#if (TLC5940_ENABLE_TRACE)
+    TLC5940_TraceFlip(1);
+#endif // TLC5940_ENABLE_TRACE
+  }
+#else // TLC5940_ENABLE_FRAME_QUEUE
+#if (TLC5940_ENABLE_TICKS)
+  TLC5940_ticks++;
+#endif // TLC5940_ENABLE_TICKS
+
+#if (TLC5940_ENABLE_SYNC)
+  // Only shift out new data on the interrupt announced on the sync line,
+  // so that every board latches it on the same tick
+  if (TLC5940_SyncFlip() && TLC5940_GetGSUpdateFlag()) {
+#else // TLC5940_ENABLE_SYNC
   if (TLC5940_GetGSUpdateFlag()) {
-    for (gsData_t i = 0; i < TLC5940_GRAYSCALE_BYTES; i++)
-      TLC5940_TX(gsData[i]);
+#endif // TLC5940_ENABLE_SYNC
+#if (TLC5940_ENABLE_RENDER)
+    TLC5940_ShiftOutRendered();
+#else // TLC5940_ENABLE_RENDER
+#if (TLC5940_ENABLE_STATUS_READBACK)
+    if (TLC5940_statusState == TLC5940_STATUS_REQUESTED)
+      TLC5940_ShiftOutAndCapture(gsData);
+    else
+#endif // TLC5940_ENABLE_STATUS_READBACK
+    TLC5940_ShiftOut(gsData);
+#endif // TLC5940_ENABLE_RENDER
+#if (TLC5940_ENABLE_PWM_SWITCHING)
+    pwmTop = TLC5940_pwmTopPending;
+    TLC5940_pwmTopPending = 0;
+#endif // TLC5940_ENABLE_PWM_SWITCHING
     TLC5940_SetXLATNeedsPulseFlagAndClearGSUpdateFlag(); // optimized
+#if (TLC5940_ENABLE_TRACE)
+    TLC5940_TraceFlip(0);
+#endif // TLC5940_ENABLE_TRACE
+  }
+#if (TLC5940_ENABLE_SYNC && TLC5940_SYNC_LEADER)
+  // Announce new data one interrupt ahead of shifting it out, giving
+  // followers a whole interrupt to line up with us
+  else if (TLC5940_GetGSUpdateFlag()) {
+    setHigh(SYNC_PORT, SYNC_PIN);
+    syncCountdown = 1;
   }
+#endif // TLC5940_ENABLE_SYNC
+
+#if (TLC5940_ENABLE_SYNC)
+  TLC5940_SyncEnd();
+#endif // TLC5940_ENABLE_SYNC
+#endif // TLC5940_ENABLE_FRAME_QUEUE
 
 #endif // TLC5940_ENABLE_MULTIPLEXING
 }
@@ -39,7 +39,13 @@
 #if (TLC5940_INCLUDE_GAMMA_CORRECT)
 #include <avr/pgmspace.h>
 extern const uint16_t TLC5940_GammaCorrect[] PROGMEM;
+#if (TLC5940_ENABLE_PWM_SWITCHING)
+extern uint8_t TLC5940_pwmBits;
+// The table is built for TLC5940_PWM_BITS, and shifted down to match
+#define TLC5940_GammaCorrect(value) (pgm_read_word(&TLC5940_GammaCorrect[(value)]) >> (uint8_t)(TLC5940_PWM_BITS - TLC5940_pwmBits))
+#else // TLC5940_ENABLE_PWM_SWITCHING
 #define TLC5940_GammaCorrect(value) (pgm_read_word(&TLC5940_GammaCorrect[(value)]))
+#endif // TLC5940_ENABLE_PWM_SWITCHING
 #endif // TLC5940_INCLUDE_GAMMA_CORRECT
 
 // These options are not configurable because they rely on specific hardware
@@ -70,6 +76,38 @@ extern const uint16_t TLC5940_GammaCorrect[] PROGMEM;
 #define SCLK_PIN PB2
 #endif // TLC5940_SPI_MODE
 
+#if (TLC5940_HARDWARE_BLANK)
+#if (TLC5940_SPI_MODE == 2)
+#error "TLC5940_HARDWARE_BLANK = 1 is only supported on the ATmega328P (TLC5940_SPI_MODE = 0 or 1)"
+#endif // TLC5940_SPI_MODE
+#if (TLC5940_XLAT_AND_BLANK_HARDWIRED_TOGETHER)
+#error "TLC5940_HARDWARE_BLANK = 1 requires separate XLAT and BLANK pins"
+#endif // TLC5940_XLAT_AND_BLANK_HARDWIRED_TOGETHER
+#if (TLC5940_ISR_CTC_TIMER == 0 && BLANK_PIN != PD5)
+#error "TLC5940_HARDWARE_BLANK = 1 with TLC5940_ISR_CTC_TIMER = 0 requires BLANK_PIN = PD5 (OC0B)"
+#elif (TLC5940_ISR_CTC_TIMER == 2 && BLANK_PIN != PD3)
+#error "TLC5940_HARDWARE_BLANK = 1 with TLC5940_ISR_CTC_TIMER = 2 requires BLANK_PIN = PD3 (OC2B)"
+#endif // TLC5940_ISR_CTC_TIMER
+#if (TLC5940_ENABLE_TWI_SLAVE || TLC5940_ENABLE_AUDIO || TLC5940_ENABLE_SYNC || TLC5940_ENABLE_POV)
+#error "TLC5940_HARDWARE_BLANK = 1 can't be used with TLC5940_ENABLE_TWI_SLAVE, TLC5940_ENABLE_AUDIO, TLC5940_ENABLE_SYNC, or TLC5940_ENABLE_POV, whose interrupts can hold off XLAT until after the 64 clock BLANK pulse has ended"
+#endif // TLC5940_ENABLE_TWI_SLAVE
+#if (TLC5940_GSCLK_DIVIDER != 1 && TLC5940_GSCLK_DIVIDER != 2 && TLC5940_GSCLK_DIVIDER != 4)
+#error "TLC5940_GSCLK_DIVIDER must be 1, 2, or 4"
+#endif // TLC5940_GSCLK_DIVIDER
+#if (TLC5940_GSCLK_DIVIDER > 1 && TLC5940_ENABLE_POV)
+#error "TLC5940_GSCLK_DIVIDER > 1 needs Timer1, which TLC5940_ENABLE_POV = 1 also uses"
+#endif // TLC5940_GSCLK_DIVIDER
+
+#if (TLC5940_GSCLK_DIVIDER > 1)
+// GSCLK is generated by Timer1 on OC1A
+#define GSCLK_DDR DDRB
+#define GSCLK_PIN PB1
+#endif // TLC5940_GSCLK_DIVIDER
+#else // TLC5940_HARDWARE_BLANK
+// GSCLK comes from the CKOUT pin, at F_CPU
+#define TLC5940_GSCLK_DIVIDER 1
+#endif // TLC5940_HARDWARE_BLANK
+
 // --------------------------------------------------------
 
 #define setOutput(ddr, pin) ((ddr) |= (1 << (pin)))
@@ -118,12 +156,181 @@ typedef uint16_t gsOffset_t;
 typedef uint8_t gsOffset_t;
 #endif
 
+// A whole frame is every row of grayscale data, in the same packed
+// format that gets shifted out to the TLC5940s
+typedef gsOffset_t gsFrame_t;
+#define TLC5940_FRAME_BYTES ((gsFrame_t)TLC5940_GRAYSCALE_BYTES * TLC5940_MULTIPLEX_N)
+
 extern const uint8_t toggleRows[2 * TLC5940_MULTIPLEX_N];
 extern uint8_t gsData[TLC5940_MULTIPLEX_N][TLC5940_GRAYSCALE_BYTES];
 extern uint8_t *pBack;
+#define TLC5940_GS_OUT pBack
 #else // TLC5940_ENABLE_MULTIPLEXING
+typedef gsData_t gsFrame_t;
+#define TLC5940_FRAME_BYTES TLC5940_GRAYSCALE_BYTES
+
+#if (TLC5940_ENABLE_RENDER == 0)
 extern uint8_t gsData[TLC5940_GRAYSCALE_BYTES];
+#if (TLC5940_ENABLE_FRAME_QUEUE)
+// The Set*GS functions write into whichever queued frame is being rendered
+extern uint8_t *pBack;
+#define TLC5940_GS_OUT pBack
+#else // TLC5940_ENABLE_FRAME_QUEUE
+#define TLC5940_GS_OUT gsData
+#endif // TLC5940_ENABLE_FRAME_QUEUE
+#endif // TLC5940_ENABLE_RENDER
+#endif // TLC5940_ENABLE_MULTIPLEXING
+
+// TLC5940_GS_OUT is the buffer that gets shown next, and TLC5940_GS_BACK
+// is the one that the Set*GS functions draw into. They are the same
+// buffer, unless the master brightness is enabled, in which case drawing
+// goes into a frame of its own that is never scaled, and
+// TLC5940_ApplyMasterBrightness() writes it, scaled, into TLC5940_GS_OUT.
+#if (TLC5940_ENABLE_RENDER == 0)
+#if (TLC5940_ENABLE_MASTER_BRIGHTNESS)
+extern uint8_t TLC5940_gsUnscaled[TLC5940_FRAME_BYTES];
+#define TLC5940_GS_BACK TLC5940_gsUnscaled
+#else // TLC5940_ENABLE_MASTER_BRIGHTNESS
+#define TLC5940_GS_BACK TLC5940_GS_OUT
+#endif // TLC5940_ENABLE_MASTER_BRIGHTNESS
+#endif // TLC5940_ENABLE_RENDER
+
+#if (TLC5940_ENABLE_RENDER)
+#if (TLC5940_ENABLE_MULTIPLEXING)
+#error "TLC5940_ENABLE_RENDER = 1 requires TLC5940_ENABLE_MULTIPLEXING = 0"
 #endif // TLC5940_ENABLE_MULTIPLEXING
+#if (TLC5940_INCLUDE_DEFAULT_ISR == 0)
+#error "TLC5940_ENABLE_RENDER = 1 requires TLC5940_INCLUDE_DEFAULT_ISR = 1"
+#endif // TLC5940_INCLUDE_DEFAULT_ISR
+#if (TLC5940_INCLUDE_DC_FUNCS)
+#error "TLC5940_ENABLE_RENDER = 1 requires TLC5940_INCLUDE_DC_FUNCS = 0, since the DC data is staged in gsData"
+#endif // TLC5940_INCLUDE_DC_FUNCS
+#if (TLC5940_ENABLE_FRAME_QUEUE || TLC5940_ENABLE_GS_QUEUE || TLC5940_INCLUDE_CROSSFADE || TLC5940_ENABLE_LAYERS)
+#error "TLC5940_ENABLE_RENDER = 1 can't be used with TLC5940_ENABLE_FRAME_QUEUE, TLC5940_ENABLE_GS_QUEUE, TLC5940_INCLUDE_CROSSFADE, or TLC5940_ENABLE_LAYERS"
+#endif // TLC5940_ENABLE_FRAME_QUEUE
+#if (TLC5940_ENABLE_POWER_GOVERNOR || TLC5940_ENABLE_STATUS_READBACK || TLC5940_ENABLE_CALIBRATION || TLC5940_INCLUDE_BOOT_FRAME)
+#error "TLC5940_ENABLE_RENDER = 1 can't be used with TLC5940_ENABLE_POWER_GOVERNOR, TLC5940_ENABLE_STATUS_READBACK, TLC5940_ENABLE_CALIBRATION, or TLC5940_INCLUDE_BOOT_FRAME"
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+#if (TLC5940_ENABLE_TWI_SLAVE || TLC5940_ENABLE_AUDIO)
+#error "TLC5940_ENABLE_RENDER = 1 can't be used with TLC5940_ENABLE_TWI_SLAVE or TLC5940_ENABLE_AUDIO"
+#endif // TLC5940_ENABLE_TWI_SLAVE
+
+// There is no grayscale buffer at all. Instead, every time the ISR
+// shifts out new data (on the interrupt after TLC5940_SetGSUpdateFlag()
+// is called), it asks tlc5940-render.h for the value of each output as
+// it goes, last chip and last output first:
+//
+//   static inline uint16_t TLC5940_Render(uint8_t chip, uint8_t output);
+//
+// which must return a 12-bit value. Each pair of outputs is rendered and
+// packed into three bytes right before they are shifted out, so the only
+// RAM used is whatever the callback itself keeps, but the ISR takes that
+// much longer per byte (see TLC5940_RENDER_CYCLES).
+#endif // TLC5940_ENABLE_RENDER
+
+// Returns (value * factor) / 256 for a 12-bit value, rounded down. This
+// is done with two 8x8 hardware multiplies instead of a 16x16 multiply:
+//   value * factor = 16 * (value >> 4) * factor + (value & 0x0F) * factor
+static inline uint16_t TLC5940_ScaleGS(uint16_t value, uint8_t factor) __attribute__(( always_inline ));
+static inline uint16_t TLC5940_ScaleGS(uint16_t value, uint8_t factor) {
+  uint16_t hi = (uint16_t)(uint8_t)(value >> 4) * factor;
+  uint16_t lo = (uint16_t)(uint8_t)(value & 0x0F) * factor;
+  return (hi + (lo >> 4)) >> 4;
+}
+
+// Returns a + (b - a) * alpha / 256 for 12-bit values a and b
+static inline uint16_t TLC5940_LerpGS(uint16_t a, uint16_t b, uint8_t alpha) __attribute__(( always_inline ));
+static inline uint16_t TLC5940_LerpGS(uint16_t a, uint16_t b, uint8_t alpha) {
+  if (b >= a)
+    return a + TLC5940_ScaleGS(b - a, alpha);
+  else
+    return a - TLC5940_ScaleGS(a - b, alpha);
+}
+
+// Unpacks one of the two channels stored in the three bytes at p
+static inline uint16_t TLC5940_GetPackedGS(const uint8_t *p, uint8_t odd) __attribute__(( always_inline ));
+static inline uint16_t TLC5940_GetPackedGS(const uint8_t *p, uint8_t odd) {
+  if (odd)
+    return ((uint16_t)(*(p + 1) & 0x0F) << 8) | *(p + 2);
+  else
+    return ((uint16_t)*p << 4) | (*(p + 1) >> 4);
+}
+
+// Number of buffers that take turns being shown next (TLC5940_GS_OUT)
+#if (TLC5940_ENABLE_FRAME_QUEUE)
+#define TLC5940_BUFFERS_N TLC5940_FRAME_QUEUE_N
+#elif (TLC5940_ENABLE_MULTIPLEXING)
+#define TLC5940_BUFFERS_N 2
+#else // TLC5940_ENABLE_FRAME_QUEUE
+#define TLC5940_BUFFERS_N 1
+#endif // TLC5940_ENABLE_FRAME_QUEUE
+
+// Number of buffers that the Set*GS functions take turns writing into,
+// so anything drawn incrementally must be redrawn into each of them
+#if (TLC5940_ENABLE_MASTER_BRIGHTNESS)
+#define TLC5940_DRAW_BUFFERS_N 1
+#else // TLC5940_ENABLE_MASTER_BRIGHTNESS
+#define TLC5940_DRAW_BUFFERS_N TLC5940_BUFFERS_N
+#endif // TLC5940_ENABLE_MASTER_BRIGHTNESS
+
+#if (TLC5940_ENABLE_TRACE)
+#include <avr/interrupt.h>
+#if (TLC5940_TRACE_N != 8 && TLC5940_TRACE_N != 16 && TLC5940_TRACE_N != 32 && TLC5940_TRACE_N != 64 && TLC5940_TRACE_N != 128)
+#error "TLC5940_TRACE_N must be 8, 16, 32, 64, or 128"
+#endif // TLC5940_TRACE_N
+#if (TLC5940_INCLUDE_DEFAULT_ISR == 0)
+#error "TLC5940_ENABLE_TRACE requires TLC5940_INCLUDE_DEFAULT_ISR = 1"
+#endif // TLC5940_INCLUDE_DEFAULT_ISR
+
+// Each entry is the low byte of the number of CTC interrupts so far, and
+// an event code, whose high nibble is the event and low nibble its
+// argument
+#define TLC5940_TRACE_NONE 0x00 // slot never written
+#define TLC5940_TRACE_WRAP 0x10 // tick counter wrapped around to 0
+#define TLC5940_TRACE_BLANK 0x20 // BLANK pulse (only if TLC5940_ENABLE_TRACE = 2), argument = row lit
+#define TLC5940_TRACE_XLAT 0x30 // XLAT latched the first row of a new frame
+#define TLC5940_TRACE_FLIP 0x40 // ISR took a new frame, argument = 1 if from the frame queue
+#define TLC5940_TRACE_SET 0x50 // TLC5940_SetGSUpdateFlag(), argument = 1 for TLC5940_QueueFrame()
+#define TLC5940_TRACE_USER 0xF0 // argument is up to the application
+
+typedef struct {
+  uint8_t tick;
+  uint8_t event;
+} TLC5940_TraceEntry_t;
+
+extern TLC5940_TraceEntry_t TLC5940_trace[TLC5940_TRACE_N];
+extern uint8_t TLC5940_traceHead; // next slot to be written
+extern uint8_t TLC5940_traceTick;
+extern bool TLC5940_traceFrozen;
+
+// Records an event. Only call with interrupts disabled, for example from
+// an ISR. Costs about 12 clock cycles.
+static inline void TLC5940_TraceFromISR(uint8_t event) __attribute__(( always_inline ));
+static inline void TLC5940_TraceFromISR(uint8_t event) {
+  if (TLC5940_traceFrozen)
+    return;
+  uint8_t head = TLC5940_traceHead;
+  TLC5940_trace[head].tick = TLC5940_traceTick;
+  TLC5940_trace[head].event = event;
+  TLC5940_traceHead = (head + 1) & (TLC5940_TRACE_N - 1);
+}
+
+// Records an event from anywhere, such as TLC5940_TRACE_USER | 3
+static inline void TLC5940_Trace(uint8_t event) __attribute__(( always_inline ));
+static inline void TLC5940_Trace(uint8_t event) {
+  uint8_t sreg = SREG;
+  cli();
+  TLC5940_TraceFromISR(event);
+  SREG = sreg;
+}
+
+// Stops recording and sends the ring through put(), one byte at a time:
+// 'T', 'R', TLC5940_TRACE_N, TLC5940_CTC_TOP, TLC5940_MULTIPLEX_N (0 if
+// not multiplexing), and then TLC5940_TRACE_N (tick, event) pairs,
+// oldest first. Recording resumes once it returns, so events in between
+// are lost. tlc5940-trace (make tlc5940-trace) decodes the output on a PC.
+void TLC5940_TraceDump(void (*put)(uint8_t));
+#endif // TLC5940_ENABLE_TRACE
 
 #if (TLC5940_USE_GPIOR0)
 #define TLC5940_FLAGS GPIOR0
@@ -135,6 +342,11 @@ extern volatile bool gsUpdateFlag;
 
 static inline void TLC5940_SetGSUpdateFlag(void) __attribute__(( always_inline ));
 static inline void TLC5940_SetGSUpdateFlag(void) {
+#if (TLC5940_ENABLE_TRACE)
+  // Recorded before the flag is set, so the ISR's flip can never be
+  // traced ahead of the SET that caused it
+  TLC5940_Trace(TLC5940_TRACE_SET);
+#endif // TLC5940_ENABLE_TRACE
   __asm__ volatile ("" ::: "memory");
 #if (TLC5940_USE_GPIOR0)
   setHigh(TLC5940_FLAGS, TLC5940_FLAG_GS_UPDATE);
@@ -212,10 +424,14 @@ static inline void TLC5940_SetXLATNeedsPulseFlagAndClearGSUpdateFlag(void) {
 static inline void TLC5940_ToggleBLANK_XLAT(void) __attribute__(( always_inline ));
 static inline void TLC5940_ToggleBLANK_XLAT(void) {
 #if (TLC5940_BLANK_AND_XLAT_SHARE_PORT == 0 && TLC5940_MULTIPLEX_AND_XLAT_SHARE_PORT == 0)
+#if (TLC5940_HARDWARE_BLANK == 0)
   togglePin(BLANK_INPUT, BLANK_PIN); // high
+#endif // TLC5940_HARDWARE_BLANK
   togglePin(XLAT_INPUT, XLAT_PIN); // high
 #elif (TLC5940_BLANK_AND_XLAT_SHARE_PORT == 0 && TLC5940_MULTIPLEX_AND_XLAT_SHARE_PORT == 1)
+#if (TLC5940_HARDWARE_BLANK == 0)
   togglePin(BLANK_INPUT, BLANK_PIN); // high
+#endif // TLC5940_HARDWARE_BLANK
   // The toggling of XLAT is embedded in the const definition of toggleRows
 #elif (TLC5940_BLANK_AND_XLAT_SHARE_PORT == 1 && TLC5940_MULTIPLEX_AND_XLAT_SHARE_PORT == 0)
 #if (TLC5940_XLAT_AND_BLANK_HARDWIRED_TOGETHER == 1)
@@ -234,10 +450,14 @@ static inline void TLC5940_ToggleXLAT_BLANK(void) __attribute__(( always_inline
 static inline void TLC5940_ToggleXLAT_BLANK(void) {
 #if (TLC5940_BLANK_AND_XLAT_SHARE_PORT == 0 && TLC5940_MULTIPLEX_AND_XLAT_SHARE_PORT == 0)
   togglePin(XLAT_INPUT, XLAT_PIN); // low
+#if (TLC5940_HARDWARE_BLANK == 0)
   togglePin(BLANK_INPUT, BLANK_PIN); // low
+#endif // TLC5940_HARDWARE_BLANK
 #elif (TLC5940_BLANK_AND_XLAT_SHARE_PORT == 0 && TLC5940_MULTIPLEX_AND_XLAT_SHARE_PORT == 1)
   // The toggling of XLAT is embedded in the const definition of toggleRows
+#if (TLC5940_HARDWARE_BLANK == 0)
   togglePin(BLANK_INPUT, BLANK_PIN); // low
+#endif // TLC5940_HARDWARE_BLANK
 #elif (TLC5940_BLANK_AND_XLAT_SHARE_PORT == 1 && TLC5940_MULTIPLEX_AND_XLAT_SHARE_PORT == 0)
 #if (TLC5940_XLAT_AND_BLANK_HARDWIRED_TOGETHER == 1)
   XLAT_INPUT = (1 << XLAT_PIN); // set shared XLAT/BLANK pin low
@@ -282,6 +502,414 @@ do {                                                                         \
  } while (0)
 #endif // TLC5940_SPI_MODE
 
+// Pipelined versions of TLC5940_TX(), for shifting out a block of bytes
+// starting at p, which is advanced past each one. Every byte after the
+// first is loaded while the one before it is still on the wire, so a
+// block must start with TLC5940_TX_FIRST() and end with TLC5940_TX_LAST().
+#if (TLC5940_SPI_MODE == 0)
+#define TLC5940_TX_FIRST(p) do {                              \
+                              SPDR = *(p)++;                  \
+                            } while (0)
+#define TLC5940_TX_NEXT(p) do {                               \
+                             uint8_t next = *(p)++;           \
+                             while (!(SPSR & (1 << SPIF)));   \
+                             SPDR = next;                     \
+                           } while (0)
+#define TLC5940_TX_LAST() do {                                \
+                            while (!(SPSR & (1 << SPIF)));    \
+                          } while (0)
+#elif (TLC5940_SPI_MODE == 1)
+#define TLC5940_TX_FIRST(p) TLC5940_TX_NEXT(p)
+#define TLC5940_TX_NEXT(p) do {                                  \
+                             uint8_t next = *(p)++;              \
+                             while (!(UCSR0A & (1 << UDRE0)));   \
+                             UDR0 = next;                        \
+                           } while (0)
+#define TLC5940_TX_LAST() do { } while (0)
+#elif (TLC5940_SPI_MODE == 2)
+#define TLC5940_TX_FIRST(p) TLC5940_TX_NEXT(p)
+#define TLC5940_TX_NEXT(p) TLC5940_TX(*(p)++)
+#define TLC5940_TX_LAST() do { } while (0)
+#endif // TLC5940_SPI_MODE
+
+#if (TLC5940_ENABLE_STATUS_READBACK)
+#if (TLC5940_SPI_MODE != 0)
+#error "TLC5940_ENABLE_STATUS_READBACK = 1 requires TLC5940_SPI_MODE = 0"
+#endif // TLC5940_SPI_MODE
+
+// Define a macro for SPI Transmit that also stores the byte received
+#define TLC5940_TXRX(data, dest) do {                              \
+                                   SPDR = (data);                  \
+                                   while (!(SPSR & (1 << SPIF)));  \
+                                   (dest) = SPDR;                  \
+                                 } while (0)
+
+// Pipelined versions of TLC5940_TXRX(), like TLC5940_TX_FIRST() and
+// friends. The byte received is read as soon as SPIF is set, and the next
+// byte, already loaded, is written right after it.
+#define TLC5940_TXRX_FIRST(p) do {                                   \
+                                SPDR = *(p)++;                       \
+                              } while (0)
+#define TLC5940_TXRX_NEXT(p, dest) do {                              \
+                                     uint8_t next = *(p)++;          \
+                                     while (!(SPSR & (1 << SPIF)));  \
+                                     uint8_t in = SPDR;              \
+                                     SPDR = next;                    \
+                                     (dest) = in;                    \
+                                   } while (0)
+#define TLC5940_TXRX_LAST(dest) do {                                 \
+                                  while (!(SPSR & (1 << SPIF)));     \
+                                  (dest) = SPDR;                     \
+                                } while (0)
+
+#define TLC5940_STATUS_IDLE 0
+#define TLC5940_STATUS_REQUESTED 1
+#define TLC5940_STATUS_READY 2
+
+// The status information (SID) each TLC5940 shifts out of SOUT, 24 bytes
+// per chip. The last TLC5940 in the chain is shifted out first, so its
+// SID occupies the first 24 bytes.
+extern uint8_t TLC5940_statusData[TLC5940_GRAYSCALE_BYTES];
+extern volatile uint8_t TLC5940_statusState;
+
+// Asks the ISR to capture the SID during the next grayscale shift. When
+// not multiplexing, that only happens once TLC5940_SetGSUpdateFlag() is
+// called.
+static inline void TLC5940_RequestStatus(void) __attribute__(( always_inline ));
+static inline void TLC5940_RequestStatus(void) {
+  TLC5940_statusState = TLC5940_STATUS_REQUESTED;
+}
+
+static inline bool TLC5940_GetStatusReady(void) __attribute__(( always_inline ));
+static inline bool TLC5940_GetStatusReady(void) {
+  return TLC5940_statusState == TLC5940_STATUS_READY;
+}
+
+// Within each chip's SID, bit 0 of the last byte is LOD for OUT0, and
+// bit 0 of the third to last byte is TEF
+#define TLC5940_SID_OFFSET(chip) ((gsData_t)24 * (TLC5940_N - 1 - (chip)))
+
+// Returns the LED open detection bits for OUT0-OUT15 of a chip, where a
+// 1 means the LED on that output is open (or disconnected). LOD is only
+// valid for outputs that were on when XLAT was pulsed.
+static inline uint16_t TLC5940_GetLOD(uint8_t chip) __attribute__(( always_inline ));
+static inline uint16_t TLC5940_GetLOD(uint8_t chip) {
+  const uint8_t *p = &TLC5940_statusData[TLC5940_SID_OFFSET(chip) + 22];
+  return ((uint16_t)*p << 8) | *(p + 1);
+}
+
+// Returns true if a chip has raised its thermal error flag
+static inline bool TLC5940_GetTEF(uint8_t chip) __attribute__(( always_inline ));
+static inline bool TLC5940_GetTEF(uint8_t chip) {
+  return TLC5940_statusData[TLC5940_SID_OFFSET(chip) + 21] & 0x01;
+}
+#endif // TLC5940_ENABLE_STATUS_READBACK
+
+// The CTC interrupt only counts ticks when something needs them
+#if (TLC5940_ENABLE_FRAME_QUEUE || TLC5940_ENABLE_SCHEDULER)
+#define TLC5940_ENABLE_TICKS 1
+#else // TLC5940_ENABLE_FRAME_QUEUE
+#define TLC5940_ENABLE_TICKS 0
+#endif // TLC5940_ENABLE_FRAME_QUEUE
+
+#if (TLC5940_ENABLE_TICKS)
+extern volatile uint16_t TLC5940_ticks; // incremented by every CTC interrupt
+
+// Returns the number of CTC interrupts since TLC5940_Init(), wrapping
+// around every 65536 ticks. Safe to call with interrupts enabled.
+static inline uint16_t TLC5940_GetTicks(void) __attribute__(( always_inline ));
+static inline uint16_t TLC5940_GetTicks(void) {
+  uint16_t ticks;
+  do {
+    ticks = TLC5940_ticks;
+  } while (ticks != TLC5940_ticks); // the ISR may have fired mid-read
+  return ticks;
+}
+#endif // TLC5940_ENABLE_TICKS
+
+#if (TLC5940_ENABLE_FRAME_QUEUE)
+#if (TLC5940_FRAME_QUEUE_N < 2 || TLC5940_FRAME_QUEUE_N > 8)
+#error "TLC5940_FRAME_QUEUE_N must be between 2 and 8, inclusive"
+#endif // TLC5940_FRAME_QUEUE_N
+
+typedef struct {
+  uint8_t *buf;
+  uint16_t tick; // value of TLC5940_ticks at which this frame is shown
+} TLC5940_Frame_t;
+
+// The frame queue is a ring of TLC5940_FRAME_QUEUE_N frame buffers. The
+// slot at TLC5940_frameHead is the one being rendered by the main loop
+// (pBack always points to its buffer), and is only ever written by the
+// main loop. The slot at TLC5940_frameShown is the one being displayed,
+// and is only ever written by the ISR. Every slot in between holds a
+// rendered frame waiting for its tick to arrive.
+extern TLC5940_Frame_t TLC5940_frames[TLC5940_FRAME_QUEUE_N];
+extern volatile uint8_t TLC5940_frameHead;
+extern volatile uint8_t TLC5940_frameShown;
+
+// While this returns true, every buffer is either queued or being
+// displayed, so the Set*GS functions must not be called
+static inline bool TLC5940_GetFrameQueueFull(void) __attribute__(( always_inline ));
+static inline bool TLC5940_GetFrameQueueFull(void) {
+  return TLC5940_frameHead == TLC5940_frameShown;
+}
+
+// Queues the frame that was just rendered, to be shown once TLC5940_ticks
+// reaches 'tick', and points pBack at the next buffer to render into.
+// When multiplexing, frames are only ever shown starting at row 0, so
+// the frame will be shown on the first row 0 at or after 'tick'. The
+// target tick must be less than 32768 ticks in the future.
+static inline void TLC5940_QueueFrame(uint16_t tick) __attribute__(( always_inline ));
+static inline void TLC5940_QueueFrame(uint16_t tick) {
+  uint8_t head = TLC5940_frameHead;
+  TLC5940_frames[head].tick = tick;
+  if (++head == TLC5940_FRAME_QUEUE_N)
+    head = 0;
+#if (TLC5940_ENABLE_TRACE)
+  // Recorded before the head is published, for the same reason as in
+  // TLC5940_SetGSUpdateFlag()
+  TLC5940_Trace(TLC5940_TRACE_SET | 1);
+#endif // TLC5940_ENABLE_TRACE
+  __asm__ volatile ("" ::: "memory"); // the tick must be stored first
+  TLC5940_frameHead = head;
+  pBack = TLC5940_frames[head].buf;
+}
+#endif // TLC5940_ENABLE_FRAME_QUEUE
+
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+#if ((TLC5940_ENABLE_LAYERS || TLC5940_ENABLE_GS_QUEUE) && TLC5940_ENABLE_MASTER_BRIGHTNESS == 0)
+#error "TLC5940_ENABLE_POWER_GOVERNOR = 1 scales the back buffer in place, so with TLC5940_ENABLE_LAYERS or TLC5940_ENABLE_GS_QUEUE it requires TLC5940_ENABLE_MASTER_BRIGHTNESS = 1"
+#endif // TLC5940_ENABLE_LAYERS || TLC5940_ENABLE_GS_QUEUE
+
+#if (TLC5940_ENABLE_MULTIPLEXING)
+#define TLC5940_POWER_ROWS TLC5940_MULTIPLEX_N
+#else // TLC5940_ENABLE_MULTIPLEXING
+#define TLC5940_POWER_ROWS 1
+#endif // TLC5940_ENABLE_MULTIPLEXING
+
+#if (TLC5940_PWM_BITS == 0)
+#define TLC5940_PWM_PERIOD ((uint16_t)(TLC5940_CTC_TOP + 1) * 64 / TLC5940_GSCLK_DIVIDER)
+#else // TLC5940_PWM_BITS
+#define TLC5940_PWM_PERIOD ((uint16_t)1 << TLC5940_PWM_BITS)
+#endif // TLC5940_PWM_BITS
+
+// Power is tracked in units of GS * DC, summed over every channel of a
+// row. A channel sinks IMAX * (DC / 63) * (GS / period), where IMAX is
+// 39.06 V / R(IREF), so the budget in mA converts to these units as:
+//   mA * 63 * period * R(IREF) / 39060 = mA * R(IREF) * period / 620
+#define TLC5940_POWER_BUDGET ((uint32_t)TLC5940_POWER_BUDGET_MA * TLC5940_R_IREF / 155 * TLC5940_PWM_PERIOD / 4)
+
+#define TLC5940_POWER_ALL_STALE ((uint8_t)(((uint16_t)1 << TLC5940_BUFFERS_N) - 1))
+
+// Running totals for every row of every buffer, kept up to date by the
+// Set*GS functions as they write. Bit n of TLC5940_powerStale is set when
+// buffer n was written in bulk (or its DC changed) and its totals have
+// to be recounted before they can be trusted again.
+extern uint32_t TLC5940_power[TLC5940_BUFFERS_N][TLC5940_POWER_ROWS];
+extern uint8_t TLC5940_powerStale;
+
+#if (TLC5940_INCLUDE_DC_FUNCS)
+// Shadow copy of the dot correction values, in the same reversed
+// channel order as gsData
+extern uint8_t TLC5940_dc[TLC5940_CHANNELS_N];
+extern uint16_t TLC5940_dcSum;
+#define TLC5940_GetChannelDC(channel) (TLC5940_dc[(channel)])
+#define TLC5940_DC_SUM TLC5940_dcSum
+#else // TLC5940_INCLUDE_DC_FUNCS
+// Without the DC functions every channel keeps its power-on DC of 63
+#define TLC5940_GetChannelDC(channel) ((void)(channel), 63)
+#define TLC5940_DC_SUM ((uint16_t)63 * TLC5940_CHANNELS_N)
+#endif // TLC5940_INCLUDE_DC_FUNCS
+
+// Returns the index of the buffer that the Set*GS functions write into
+static inline uint8_t TLC5940_GetBackIndex(void) __attribute__(( always_inline ));
+static inline uint8_t TLC5940_GetBackIndex(void) {
+#if (TLC5940_ENABLE_FRAME_QUEUE)
+  return TLC5940_frameHead;
+#elif (TLC5940_ENABLE_MULTIPLEXING)
+  return (pBack == &gsData[0][0]) ? 0 : 1;
+#else // TLC5940_ENABLE_FRAME_QUEUE
+  return 0;
+#endif // TLC5940_ENABLE_FRAME_QUEUE
+}
+
+static inline void TLC5940_MarkPowerStale(void) __attribute__(( always_inline ));
+static inline void TLC5940_MarkPowerStale(void) {
+  TLC5940_powerStale |= (uint8_t)((uint8_t)1 << TLC5940_GetBackIndex());
+}
+
+// Adjusts the back buffer's total for 'row' as (reversed) 'channel'
+// changes from 'old' to 'value'
+static inline void TLC5940_AccountGS(uint8_t row, channel_t channel, uint16_t old, uint16_t value) __attribute__(( always_inline ));
+static inline void TLC5940_AccountGS(uint8_t row, channel_t channel, uint16_t old, uint16_t value) {
+  uint32_t *p = &TLC5940_power[TLC5940_GetBackIndex()][row];
+  uint8_t dc = TLC5940_GetChannelDC(channel);
+  if (value >= old)
+    *p += (uint32_t)(uint16_t)(value - old) * dc;
+  else
+    *p -= (uint32_t)(uint16_t)(old - value) * dc;
+}
+
+// Returns the total of the back buffer's busiest row, recounting it
+// first if it was written in bulk since the last call
+uint32_t TLC5940_GetPower(void);
+
+// Call right before TLC5940_SetGSUpdateFlag() or TLC5940_QueueFrame().
+// If the back buffer's busiest row is over TLC5940_POWER_BUDGET, every
+// channel is scaled down by the same 8-bit factor so that it fits, and
+// true is returned. Costs O(1) unless the frame was written in bulk or
+// actually needs scaling. The scaling is done in place, so unless
+// TLC5940_ENABLE_MASTER_BRIGHTNESS = 1 (which writes the buffer afresh
+// every frame, and recounts it), the whole back buffer must be redrawn
+// before every call, or the scaling compounds with that of the last
+// frame drawn into it.
+bool TLC5940_ApplyPowerBudget(void);
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+
+#if (TLC5940_INCLUDE_GROUP_FUNCS)
+#include "tlc5940-groups.h"
+#if (TLC5940_GROUPS_N < 1 || TLC5940_GROUPS_N > 16)
+#error "TLC5940_GROUPS_N in tlc5940-groups.h must be between 1 and 16, inclusive"
+#endif // TLC5940_GROUPS_N
+
+// Expands op(group) for every group described in tlc5940-groups.h
+#define TLC5940_GROUP_IF_0(op) op(0)
+#if (TLC5940_GROUPS_N > 1)
+#define TLC5940_GROUP_IF_1(op) op(1)
+#else // TLC5940_GROUPS_N
+#define TLC5940_GROUP_IF_1(op)
+#endif // TLC5940_GROUPS_N
+#if (TLC5940_GROUPS_N > 2)
+#define TLC5940_GROUP_IF_2(op) op(2)
+#else // TLC5940_GROUPS_N
+#define TLC5940_GROUP_IF_2(op)
+#endif // TLC5940_GROUPS_N
+#if (TLC5940_GROUPS_N > 3)
+#define TLC5940_GROUP_IF_3(op) op(3)
+#else // TLC5940_GROUPS_N
+#define TLC5940_GROUP_IF_3(op)
+#endif // TLC5940_GROUPS_N
+#if (TLC5940_GROUPS_N > 4)
+#define TLC5940_GROUP_IF_4(op) op(4)
+#else // TLC5940_GROUPS_N
+#define TLC5940_GROUP_IF_4(op)
+#endif // TLC5940_GROUPS_N
+#if (TLC5940_GROUPS_N > 5)
+#define TLC5940_GROUP_IF_5(op) op(5)
+#else // TLC5940_GROUPS_N
+#define TLC5940_GROUP_IF_5(op)
+#endif // TLC5940_GROUPS_N
+#if (TLC5940_GROUPS_N > 6)
+#define TLC5940_GROUP_IF_6(op) op(6)
+#else // TLC5940_GROUPS_N
+#define TLC5940_GROUP_IF_6(op)
+#endif // TLC5940_GROUPS_N
+#if (TLC5940_GROUPS_N > 7)
+#define TLC5940_GROUP_IF_7(op) op(7)
+#else // TLC5940_GROUPS_N
+#define TLC5940_GROUP_IF_7(op)
+#endif // TLC5940_GROUPS_N
+#if (TLC5940_GROUPS_N > 8)
+#define TLC5940_GROUP_IF_8(op) op(8)
+#else // TLC5940_GROUPS_N
+#define TLC5940_GROUP_IF_8(op)
+#endif // TLC5940_GROUPS_N
+#if (TLC5940_GROUPS_N > 9)
+#define TLC5940_GROUP_IF_9(op) op(9)
+#else // TLC5940_GROUPS_N
+#define TLC5940_GROUP_IF_9(op)
+#endif // TLC5940_GROUPS_N
+#if (TLC5940_GROUPS_N > 10)
+#define TLC5940_GROUP_IF_10(op) op(10)
+#else // TLC5940_GROUPS_N
+#define TLC5940_GROUP_IF_10(op)
+#endif // TLC5940_GROUPS_N
+#if (TLC5940_GROUPS_N > 11)
+#define TLC5940_GROUP_IF_11(op) op(11)
+#else // TLC5940_GROUPS_N
+#define TLC5940_GROUP_IF_11(op)
+#endif // TLC5940_GROUPS_N
+#if (TLC5940_GROUPS_N > 12)
+#define TLC5940_GROUP_IF_12(op) op(12)
+#else // TLC5940_GROUPS_N
+#define TLC5940_GROUP_IF_12(op)
+#endif // TLC5940_GROUPS_N
+#if (TLC5940_GROUPS_N > 13)
+#define TLC5940_GROUP_IF_13(op) op(13)
+#else // TLC5940_GROUPS_N
+#define TLC5940_GROUP_IF_13(op)
+#endif // TLC5940_GROUPS_N
+#if (TLC5940_GROUPS_N > 14)
+#define TLC5940_GROUP_IF_14(op) op(14)
+#else // TLC5940_GROUPS_N
+#define TLC5940_GROUP_IF_14(op)
+#endif // TLC5940_GROUPS_N
+#if (TLC5940_GROUPS_N > 15)
+#define TLC5940_GROUP_IF_15(op) op(15)
+#else // TLC5940_GROUPS_N
+#define TLC5940_GROUP_IF_15(op)
+#endif // TLC5940_GROUPS_N
+#define TLC5940_FOR_EACH_GROUP(op) TLC5940_GROUP_IF_0(op) \
+                                   TLC5940_GROUP_IF_1(op) \
+                                   TLC5940_GROUP_IF_2(op) \
+                                   TLC5940_GROUP_IF_3(op) \
+                                   TLC5940_GROUP_IF_4(op) \
+                                   TLC5940_GROUP_IF_5(op) \
+                                   TLC5940_GROUP_IF_6(op) \
+                                   TLC5940_GROUP_IF_7(op) \
+                                   TLC5940_GROUP_IF_8(op) \
+                                   TLC5940_GROUP_IF_9(op) \
+                                   TLC5940_GROUP_IF_10(op) \
+                                   TLC5940_GROUP_IF_11(op) \
+                                   TLC5940_GROUP_IF_12(op) \
+                                   TLC5940_GROUP_IF_13(op) \
+                                   TLC5940_GROUP_IF_14(op) \
+                                   TLC5940_GROUP_IF_15(op)
+
+// Stores a 12-bit value, already split into the bytes it is packed into,
+// into one output of the chip whose grayscale data starts at p. It is
+// only ever called with a constant output, so it folds down to one or two
+// byte stores, and the stores of two outputs that share a byte are merged
+// into one.
+static inline void TLC5940_StoreGroupGS(uint8_t *p, uint8_t output, uint8_t tmp1, uint8_t tmp2, uint8_t tmp3) __attribute__(( always_inline ));
+static inline void TLC5940_StoreGroupGS(uint8_t *p, uint8_t output, uint8_t tmp1, uint8_t tmp2, uint8_t tmp3) {
+  output = 15 - output;
+  uint8_t i = output * 3 / 2;
+
+  if (output % 2 == 0) {
+    *(p + i) = tmp1;                                      // bits: 11 10 09 08 07 06 05 04
+    *(p + i + 1) = (*(p + i + 1) & 0x0F) | (tmp2 & 0xF0); // bits: 03 02 01 00 -- -- -- --
+  } else {
+    *(p + i) = (*(p + i) & 0xF0) | (tmp2 & 0x0F);         // bits: -- -- -- -- 11 10 09 08
+    *(p + i + 1) = tmp3;                                  // bits: 07 06 05 04 03 02 01 00
+  }
+}
+
+#define TLC5940_GROUP_STORE_GS(output) TLC5940_StoreGroupGS(p, (output), tmp1, tmp2, (uint8_t)value);
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+// Adjusts the power total of 'row' for one output of the chip whose
+// grayscale data starts at p and whose output 15 is (reversed) 'channel'.
+// Must be called before the output's new value is stored.
+static inline void TLC5940_AccountGroupGS(uint8_t row, const uint8_t *p, channel_t channel, uint8_t output, uint16_t value) __attribute__(( always_inline ));
+static inline void TLC5940_AccountGroupGS(uint8_t row, const uint8_t *p, channel_t channel, uint8_t output, uint16_t value) {
+  output = 15 - output;
+  uint8_t i = output * 3 / 2;
+
+  TLC5940_AccountGS(row, channel + output, TLC5940_GetPackedGS(p + i - output % 2, output % 2), value);
+}
+
+#define TLC5940_GROUP_SET_GS(output) TLC5940_AccountGroupGS(row, p, channel, (output), value); \
+                                     TLC5940_GROUP_STORE_GS(output)
+#else // TLC5940_ENABLE_POWER_GOVERNOR
+#define TLC5940_GROUP_SET_GS(output) TLC5940_GROUP_STORE_GS(output)
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+#define TLC5940_GROUP_CASE_GS(group) case group: TLC5940_GROUP_##group(TLC5940_GROUP_SET_GS) break;
+#define TLC5940_GROUP_ALL_GS(group) value = *(values + group);                       \
+                                    tmp1 = (value >> 4);                             \
+                                    tmp2 = (uint8_t)(value << 4) | (tmp1 >> 4);      \
+                                    TLC5940_GROUP_##group(TLC5940_GROUP_STORE_GS)
+#endif // TLC5940_INCLUDE_GROUP_FUNCS
+
 #if (TLC5940_INCLUDE_DC_FUNCS)
 #if (12 * TLC5940_N > 255)
 typedef uint16_t dcData_t;
@@ -303,6 +931,13 @@ static        void TLC5940_SetDC(channel_t channel, uint8_t value) {
 #if (TLC5940_ENABLE_MULTIPLEXING == 0)
   uint8_t *pBack = &gsData[0];
 #endif // TLC5940_ENABLE_MULTIPLEXING
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+  // Every buffer's totals depend on DC, and the DC data being staged here
+  // overwrites the start of the grayscale data, so all get recounted
+  TLC5940_dcSum = TLC5940_dcSum - TLC5940_dc[channel] + value;
+  TLC5940_dc[channel] = value;
+  TLC5940_powerStale = TLC5940_POWER_ALL_STALE;
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
 
   switch (channel % 4) {
   case 0:
@@ -334,6 +969,12 @@ static        void TLC5940_SetAllDC(uint8_t value) {
 #if (TLC5940_ENABLE_MULTIPLEXING == 0)
   uint8_t *pBack = &gsData[0];
 #endif // TLC5940_ENABLE_MULTIPLEXING
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+  for (channel_t c = 0; c < TLC5940_CHANNELS_N; c++)
+    TLC5940_dc[c] = value;
+  TLC5940_dcSum = (uint16_t)value * TLC5940_CHANNELS_N;
+  TLC5940_powerStale = TLC5940_POWER_ALL_STALE;
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
   uint8_t tmp1 = (uint8_t)(value << 2);
   uint8_t tmp2 = (uint8_t)(tmp1 << 2);
   uint8_t tmp3 = (uint8_t)(tmp2 << 2);
@@ -365,6 +1006,13 @@ static        void TLC5940_Set4DC(channel_t channel, uint8_t value) {
 #if (TLC5940_ENABLE_MULTIPLEXING == 0)
   uint8_t *pBack = &gsData[0];
 #endif // TLC5940_ENABLE_MULTIPLEXING
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+  for (uint8_t j = 0; j < 4; j++) {
+    TLC5940_dcSum = TLC5940_dcSum - TLC5940_dc[channel + j] + value;
+    TLC5940_dc[channel + j] = value;
+  }
+  TLC5940_powerStale = TLC5940_POWER_ALL_STALE;
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
 
   uint8_t tmp1 = (uint8_t)(value << 2);
   uint8_t tmp2 = (uint8_t)(tmp1 << 2);
@@ -379,6 +1027,97 @@ static        void TLC5940_Set4DC(channel_t channel, uint8_t value) {
 }
 #endif // TLC5940_INCLUDE_SET4_FUNCS
 
+#if (TLC5940_INCLUDE_GROUP_FUNCS)
+// Same as TLC5940_StoreGroupGS(), but for the dot correction data of the
+// chip that starts at p, and its first (reversed) channel 'first'
+static inline void TLC5940_StoreGroupDC(uint8_t *p, channel_t first, uint8_t output, uint8_t value) __attribute__(( always_inline ));
+static inline void TLC5940_StoreGroupDC(uint8_t *p, channel_t first, uint8_t output, uint8_t value) {
+  output = 15 - output;
+  uint8_t i = output * 3 / 4;
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+  TLC5940_dcSum = TLC5940_dcSum - TLC5940_dc[first + output] + value;
+  TLC5940_dc[first + output] = value;
+#else // TLC5940_ENABLE_POWER_GOVERNOR
+  (void)first;
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+
+  switch (output % 4) {
+  case 0:
+    *(p + i) = (*(p + i) & 0x03) | (uint8_t)(value << 2);
+    break;
+  case 1:
+    *(p + i) = (*(p + i) & 0xFC) | (value >> 4);
+    i++;
+    *(p + i) = (*(p + i) & 0x0F) | (uint8_t)(value << 4);
+    break;
+  case 2:
+    *(p + i) = (*(p + i) & 0xF0) | (value >> 2);
+    i++;
+    *(p + i) = (*(p + i) & 0x3F) | (uint8_t)(value << 6);
+    break;
+  default: // case 3:
+    *(p + i) = (*(p + i) & 0xC0) | (value);
+    break;
+  }
+}
+
+#define TLC5940_GROUP_STORE_DC(output) TLC5940_StoreGroupDC(p, first, (output), value);
+#define TLC5940_GROUP_CASE_DC(group) case group: TLC5940_GROUP_##group(TLC5940_GROUP_STORE_DC) break;
+#define TLC5940_GROUP_ALL_DC(group) value = *(values + group);                       \
+                                    TLC5940_GROUP_##group(TLC5940_GROUP_STORE_DC)
+
+// Sets the dot correction of every output of 'group' (as described in
+// tlc5940-groups.h) on 'chip'
+#if (TLC5940_INLINE_SETDC_FUNCS)
+static inline void TLC5940_SetGroupDC(uint8_t chip, uint8_t group, uint8_t value) __attribute__(( always_inline ));
+static inline void TLC5940_SetGroupDC(uint8_t chip, uint8_t group, uint8_t value) {
+#else // TLC5940_INLINE_SETDC_FUNCS
+static        void TLC5940_SetGroupDC(uint8_t chip, uint8_t group, uint8_t value) __attribute__(( noinline, unused ));
+static        void TLC5940_SetGroupDC(uint8_t chip, uint8_t group, uint8_t value) {
+#endif // TLC5940_INLINE_SETDC_FUNCS
+#if (TLC5940_ENABLE_MULTIPLEXING == 0)
+  uint8_t *pBack = &gsData[0];
+#endif // TLC5940_ENABLE_MULTIPLEXING
+  uint8_t *p = pBack + (dcData_t)12 * (TLC5940_N - 1 - chip);
+  channel_t first = (channel_t)16 * (TLC5940_N - 1 - chip);
+
+  switch (group) {
+  TLC5940_FOR_EACH_GROUP(TLC5940_GROUP_CASE_DC)
+  }
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+  TLC5940_powerStale = TLC5940_POWER_ALL_STALE;
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+}
+
+// Sets the dot correction of every group on every chip from 'values',
+// which holds TLC5940_GROUPS_N values for chip 0, followed by
+// TLC5940_GROUPS_N values for chip 1, and so on
+#if (TLC5940_INLINE_SETDC_FUNCS)
+static inline void TLC5940_SetAllGroupsDC(const uint8_t *values) __attribute__(( always_inline ));
+static inline void TLC5940_SetAllGroupsDC(const uint8_t *values) {
+#else // TLC5940_INLINE_SETDC_FUNCS
+static        void TLC5940_SetAllGroupsDC(const uint8_t *values) __attribute__(( noinline, unused ));
+static        void TLC5940_SetAllGroupsDC(const uint8_t *values) {
+#endif // TLC5940_INLINE_SETDC_FUNCS
+#if (TLC5940_ENABLE_MULTIPLEXING == 0)
+  uint8_t *pBack = &gsData[0];
+#endif // TLC5940_ENABLE_MULTIPLEXING
+  uint8_t *p = pBack + TLC5940_DOT_CORRECTION_BYTES;
+  channel_t first = TLC5940_CHANNELS_N;
+  uint8_t value;
+
+  for (uint8_t chip = 0; chip < TLC5940_N; chip++) {
+    p -= 12;
+    first -= 16;
+    TLC5940_FOR_EACH_GROUP(TLC5940_GROUP_ALL_DC)
+    values += TLC5940_GROUPS_N;
+  }
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+  TLC5940_powerStale = TLC5940_POWER_ALL_STALE;
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+}
+#endif // TLC5940_INCLUDE_GROUP_FUNCS
+
 static inline void TLC5940_ClockInDC(void) __attribute__(( always_inline ));
 static inline void TLC5940_ClockInDC(void) {
 #if (TLC5940_DCPRG_HARDWIRED_TO_VCC == 0)
@@ -400,6 +1139,7 @@ static inline void TLC5940_ClockInDC(void) {
 }
 #endif // TLC5940_INCLUDE_DC_FUNCS
 
+#if (TLC5940_ENABLE_RENDER == 0)
 #if (TLC5940_ENABLE_MULTIPLEXING)
 #if (TLC5940_INLINE_SETGS_FUNCS)
 static inline void TLC5940_SetGS(uint8_t row, channel_t channel, uint16_t value) __attribute__(( always_inline ));
@@ -410,15 +1150,18 @@ static        void TLC5940_SetGS(uint8_t row, channel_t channel, uint16_t value)
 #endif // TLC5940_INLINE_SETGS_FUNCS
   channel = TLC5940_CHANNELS_N - 1 - channel;
   uint16_t offset = (uint16_t)((channel3_t)channel * 3 / 2) + (gsOffset_t)TLC5940_GRAYSCALE_BYTES * row;
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+  TLC5940_AccountGS(row, channel, TLC5940_GetPackedGS(TLC5940_GS_BACK + offset - channel % 2, channel % 2), value);
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
 
   switch (channel % 2) {
   case 0:
-    *(pBack + offset++) = (value >> 4);
-    *(pBack + offset) = (*(pBack + offset) & 0x0F) | (uint8_t)(value << 4);
+    *(TLC5940_GS_BACK + offset++) = (value >> 4);
+    *(TLC5940_GS_BACK + offset) = (*(TLC5940_GS_BACK + offset) & 0x0F) | (uint8_t)(value << 4);
     break;
   default: // case 1:
-    *(pBack + offset) = (*(pBack + offset) & 0xF0) | (value >> 8);
-    *(pBack + ++offset) = (uint8_t)value;
+    *(TLC5940_GS_BACK + offset) = (*(TLC5940_GS_BACK + offset) & 0xF0) | (value >> 8);
+    *(TLC5940_GS_BACK + ++offset) = (uint8_t)value;
     break;
   }
 }
@@ -432,15 +1175,18 @@ static        void TLC5940_SetGS(channel_t channel, uint16_t value) {
 #endif // TLC5940_INLINE_SETGS_FUNCS
   channel = TLC5940_CHANNELS_N - 1 - channel;
   channel3_t i = (channel3_t)channel * 3 / 2;
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+  TLC5940_AccountGS(0, channel, TLC5940_GetPackedGS(&TLC5940_GS_BACK[i - channel % 2], channel % 2), value);
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
 
   switch (channel % 2) {
   case 0:
-    gsData[i++] = (value >> 4);
-    gsData[i] = (gsData[i] & 0x0F) | (uint8_t)(value << 4);
+    TLC5940_GS_BACK[i++] = (value >> 4);
+    TLC5940_GS_BACK[i] = (TLC5940_GS_BACK[i] & 0x0F) | (uint8_t)(value << 4);
     break;
   default: // case 1:
-    gsData[i] = (gsData[i] & 0xF0) | (value >> 8);
-    gsData[++i] = (uint8_t)value;
+    TLC5940_GS_BACK[i] = (TLC5940_GS_BACK[i] & 0xF0) | (value >> 8);
+    TLC5940_GS_BACK[++i] = (uint8_t)value;
     break;
   }
 }
@@ -459,10 +1205,13 @@ static        void TLC5940_SetAllGS(uint8_t row, uint16_t value) {
 
   gsOffset_t offset = (gsOffset_t)TLC5940_GRAYSCALE_BYTES * row;
   gsData_t i = TLC5940_GRAYSCALE_BYTES / 3 + 1;
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+  TLC5940_power[TLC5940_GetBackIndex()][row] = (uint32_t)value * TLC5940_DC_SUM;
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
   while (--i) {
-    *(pBack + offset++) = tmp1;              // bits: 11 10 09 08 07 06 05 04
-    *(pBack + offset++) = tmp2;              // bits: 03 02 01 00 11 10 09 08
-    *(pBack + offset++) = (uint8_t)value;    // bits: 07 06 05 04 03 02 01 00
+    *(TLC5940_GS_BACK + offset++) = tmp1;              // bits: 11 10 09 08 07 06 05 04
+    *(TLC5940_GS_BACK + offset++) = tmp2;              // bits: 03 02 01 00 11 10 09 08
+    *(TLC5940_GS_BACK + offset++) = (uint8_t)value;    // bits: 07 06 05 04 03 02 01 00
   }
 }
 #else // TLC5940_ENABLE_MULTIPLEXING
@@ -475,12 +1224,16 @@ static        void TLC5940_SetAllGS(uint16_t value) {
 #endif // TLC5940_INLINE_SETGS_FUNCS
   uint8_t tmp1 = (value >> 4);
   uint8_t tmp2 = (uint8_t)(value << 4) | (tmp1 >> 4);
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+  TLC5940_power[TLC5940_GetBackIndex()][0] = (uint32_t)value * TLC5940_DC_SUM;
+  TLC5940_powerStale &= (uint8_t)~((uint8_t)1 << TLC5940_GetBackIndex());
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
 
   gsData_t i = 0;
   do {
-    gsData[i++] = tmp1;              // bits: 11 10 09 08 07 06 05 04
-    gsData[i++] = tmp2;              // bits: 03 02 01 00 11 10 09 08
-    gsData[i++] = (uint8_t)value;    // bits: 07 06 05 04 03 02 01 00
+    TLC5940_GS_BACK[i++] = tmp1;              // bits: 11 10 09 08 07 06 05 04
+    TLC5940_GS_BACK[i++] = tmp2;              // bits: 03 02 01 00 11 10 09 08
+    TLC5940_GS_BACK[i++] = (uint8_t)value;    // bits: 07 06 05 04 03 02 01 00
   } while (i < TLC5940_GRAYSCALE_BYTES);
 }
 #endif // TLC5940_ENABLE_MULTIPLEXING
@@ -499,16 +1252,20 @@ static        void TLC5940_Set4GS(uint8_t row, channel_t channel, uint16_t value
 #endif // TLC5940_INLINE_SETGS_FUNCS
   channel = TLC5940_CHANNELS_N - 1 - (channel * 4) - 3;
   uint16_t offset = (uint16_t)((channel3_t)channel * 3 / 2) + (gsOffset_t)TLC5940_GRAYSCALE_BYTES * row;
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+  for (uint8_t j = 0; j < 4; j++)
+    TLC5940_AccountGS(row, channel + j, TLC5940_GetPackedGS(TLC5940_GS_BACK + offset + (j / 2) * 3, j % 2), value);
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
 
   uint8_t tmp1 = (value >> 4);
   uint8_t tmp2 = (uint8_t)(value << 4) | (tmp1 >> 4);
 
-  *(pBack + offset++) = tmp1;              // bits: 11 10 09 08 07 06 05 04
-  *(pBack + offset++) = tmp2;              // bits: 03 02 01 00 11 10 09 08
-  *(pBack + offset++) = (uint8_t)value;    // bits: 07 06 05 04 03 02 01 00
-  *(pBack + offset++) = tmp1;              // bits: 11 10 09 08 07 06 05 04
-  *(pBack + offset++) = tmp2;              // bits: 03 02 01 00 11 10 09 08
-  *(pBack + offset) = (uint8_t)value;      // bits: 07 06 05 04 03 02 01 00
+  *(TLC5940_GS_BACK + offset++) = tmp1;              // bits: 11 10 09 08 07 06 05 04
+  *(TLC5940_GS_BACK + offset++) = tmp2;              // bits: 03 02 01 00 11 10 09 08
+  *(TLC5940_GS_BACK + offset++) = (uint8_t)value;    // bits: 07 06 05 04 03 02 01 00
+  *(TLC5940_GS_BACK + offset++) = tmp1;              // bits: 11 10 09 08 07 06 05 04
+  *(TLC5940_GS_BACK + offset++) = tmp2;              // bits: 03 02 01 00 11 10 09 08
+  *(TLC5940_GS_BACK + offset) = (uint8_t)value;      // bits: 07 06 05 04 03 02 01 00
 }
 #else // TLC5940_ENABLE_MULTIPLEXING
 #if (TLC5940_INLINE_SETGS_FUNCS)
@@ -520,20 +1277,665 @@ static        void TLC5940_Set4GS(channel_t channel, uint16_t value) {
 #endif // TLC5940_INLINE_SETGS_FUNCS
   channel = TLC5940_CHANNELS_N - 1 - (channel * 4) - 3;
   channel3_t i = (channel3_t)channel * 3 / 2;
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+  for (uint8_t j = 0; j < 4; j++)
+    TLC5940_AccountGS(0, channel + j, TLC5940_GetPackedGS(&TLC5940_GS_BACK[i + (j / 2) * 3], j % 2), value);
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
 
   uint8_t tmp1 = (value >> 4);
   uint8_t tmp2 = (uint8_t)(value << 4) | (tmp1 >> 4);
 
-  gsData[i++] = tmp1;              // bits: 11 10 09 08 07 06 05 04
-  gsData[i++] = tmp2;              // bits: 03 02 01 00 11 10 09 08
-  gsData[i++] = (uint8_t)value;    // bits: 07 06 05 04 03 02 01 00
-  gsData[i++] = tmp1;              // bits: 11 10 09 08 07 06 05 04
-  gsData[i++] = tmp2;              // bits: 03 02 01 00 11 10 09 08
-  gsData[i] = (uint8_t)value;      // bits: 07 06 05 04 03 02 01 00
+  TLC5940_GS_BACK[i++] = tmp1;              // bits: 11 10 09 08 07 06 05 04
+  TLC5940_GS_BACK[i++] = tmp2;              // bits: 03 02 01 00 11 10 09 08
+  TLC5940_GS_BACK[i++] = (uint8_t)value;    // bits: 07 06 05 04 03 02 01 00
+  TLC5940_GS_BACK[i++] = tmp1;              // bits: 11 10 09 08 07 06 05 04
+  TLC5940_GS_BACK[i++] = tmp2;              // bits: 03 02 01 00 11 10 09 08
+  TLC5940_GS_BACK[i] = (uint8_t)value;      // bits: 07 06 05 04 03 02 01 00
 }
 #endif // TLC5940_ENABLE_MULTIPLEXING
 #endif // TLC5940_INCLUDE_SET4_FUNCS
 
+#if (TLC5940_INCLUDE_GROUP_FUNCS)
+// Sets the grayscale value of every output of 'group' (as described in
+// tlc5940-groups.h) on 'chip'
+#if (TLC5940_ENABLE_MULTIPLEXING)
+#if (TLC5940_INLINE_SETGS_FUNCS)
+static inline void TLC5940_SetGroupGS(uint8_t row, uint8_t chip, uint8_t group, uint16_t value) __attribute__(( always_inline ));
+static inline void TLC5940_SetGroupGS(uint8_t row, uint8_t chip, uint8_t group, uint16_t value) {
+#else // TLC5940_INLINE_SETGS_FUNCS
+static        void TLC5940_SetGroupGS(uint8_t row, uint8_t chip, uint8_t group, uint16_t value) __attribute__(( noinline, unused ));
+static        void TLC5940_SetGroupGS(uint8_t row, uint8_t chip, uint8_t group, uint16_t value) {
+#endif // TLC5940_INLINE_SETGS_FUNCS
+  uint8_t *p = TLC5940_GS_BACK + (gsOffset_t)TLC5940_GRAYSCALE_BYTES * row + (gsData_t)24 * (TLC5940_N - 1 - chip);
+#else // TLC5940_ENABLE_MULTIPLEXING
+#if (TLC5940_INLINE_SETGS_FUNCS)
+static inline void TLC5940_SetGroupGS(uint8_t chip, uint8_t group, uint16_t value) __attribute__(( always_inline ));
+static inline void TLC5940_SetGroupGS(uint8_t chip, uint8_t group, uint16_t value) {
+#else // TLC5940_INLINE_SETGS_FUNCS
+static        void TLC5940_SetGroupGS(uint8_t chip, uint8_t group, uint16_t value) __attribute__(( noinline, unused ));
+static        void TLC5940_SetGroupGS(uint8_t chip, uint8_t group, uint16_t value) {
+#endif // TLC5940_INLINE_SETGS_FUNCS
+  uint8_t *p = &TLC5940_GS_BACK[0] + (gsData_t)24 * (TLC5940_N - 1 - chip);
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+  const uint8_t row = 0;
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+#endif // TLC5940_ENABLE_MULTIPLEXING
+  uint8_t tmp1 = (value >> 4);
+  uint8_t tmp2 = (uint8_t)(value << 4) | (tmp1 >> 4);
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+  channel_t channel = (channel_t)16 * (TLC5940_N - 1 - chip);
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+
+  switch (group) {
+  TLC5940_FOR_EACH_GROUP(TLC5940_GROUP_CASE_GS)
+  }
+}
+
+// Sets the grayscale value of every group on every chip from 'values',
+// which holds TLC5940_GROUPS_N values for chip 0, followed by
+// TLC5940_GROUPS_N values for chip 1, and so on
+#if (TLC5940_ENABLE_MULTIPLEXING)
+#if (TLC5940_INLINE_SETGS_FUNCS)
+static inline void TLC5940_SetAllGroupsGS(uint8_t row, const uint16_t *values) __attribute__(( always_inline ));
+static inline void TLC5940_SetAllGroupsGS(uint8_t row, const uint16_t *values) {
+#else // TLC5940_INLINE_SETGS_FUNCS
+static        void TLC5940_SetAllGroupsGS(uint8_t row, const uint16_t *values) __attribute__(( noinline, unused ));
+static        void TLC5940_SetAllGroupsGS(uint8_t row, const uint16_t *values) {
+#endif // TLC5940_INLINE_SETGS_FUNCS
+  uint8_t *p = TLC5940_GS_BACK + (gsOffset_t)TLC5940_GRAYSCALE_BYTES * (row + 1);
+#else // TLC5940_ENABLE_MULTIPLEXING
+#if (TLC5940_INLINE_SETGS_FUNCS)
+static inline void TLC5940_SetAllGroupsGS(const uint16_t *values) __attribute__(( always_inline ));
+static inline void TLC5940_SetAllGroupsGS(const uint16_t *values) {
+#else // TLC5940_INLINE_SETGS_FUNCS
+static        void TLC5940_SetAllGroupsGS(const uint16_t *values) __attribute__(( noinline, unused ));
+static        void TLC5940_SetAllGroupsGS(const uint16_t *values) {
+#endif // TLC5940_INLINE_SETGS_FUNCS
+  uint8_t *p = &TLC5940_GS_BACK[0] + TLC5940_GRAYSCALE_BYTES;
+#endif // TLC5940_ENABLE_MULTIPLEXING
+  uint16_t value;
+  uint8_t tmp1, tmp2;
+#if (TLC5940_ENABLE_POWER_GOVERNOR)
+  TLC5940_MarkPowerStale();
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+
+  for (uint8_t chip = 0; chip < TLC5940_N; chip++) {
+    p -= 24;
+    TLC5940_FOR_EACH_GROUP(TLC5940_GROUP_ALL_GS)
+    values += TLC5940_GROUPS_N;
+  }
+}
+#endif // TLC5940_INCLUDE_GROUP_FUNCS
+#endif // TLC5940_ENABLE_RENDER
+
+#if (TLC5940_ENABLE_GS_QUEUE)
+#if (TLC5940_GS_QUEUE_SIZE < 2 || TLC5940_GS_QUEUE_SIZE > 128)
+#error "TLC5940_GS_QUEUE_SIZE must be a power of two between 2 and 128, inclusive"
+#endif // TLC5940_GS_QUEUE_SIZE
+#if ((TLC5940_GS_QUEUE_SIZE & (TLC5940_GS_QUEUE_SIZE - 1)) != 0)
+#error "TLC5940_GS_QUEUE_SIZE must be a power of two between 2 and 128, inclusive"
+#endif // TLC5940_GS_QUEUE_SIZE
+#if (TLC5940_GS_QUEUE_BATCH < 1 || TLC5940_GS_QUEUE_BATCH > 255)
+#error "TLC5940_GS_QUEUE_BATCH must be between 1 and 255, inclusive"
+#endif // TLC5940_GS_QUEUE_BATCH
+
+typedef struct {
+#if (TLC5940_ENABLE_MULTIPLEXING)
+  uint8_t row;
+#endif // TLC5940_ENABLE_MULTIPLEXING
+  channel_t channel;
+  uint16_t value;
+} TLC5940_GSCommand_t;
+
+// The head index is only ever written by the producer, and the tail
+// index is only ever written by the consumer. Both are free-running and
+// 8 bits wide, so reading or writing either one is a single instruction
+// and no interrupts ever need to be disabled.
+extern TLC5940_GSCommand_t TLC5940_gsQueue[TLC5940_GS_QUEUE_SIZE];
+extern volatile uint8_t TLC5940_gsQueueHead;
+extern volatile uint8_t TLC5940_gsQueueTail;
+
+// Queues a grayscale update to be applied by the next call to
+// TLC5940_DrainGSQueue(). Intended to be called from exactly one
+// interrupt handler. Returns false if the queue is full, in which case
+// the update is dropped.
+#if (TLC5940_ENABLE_MULTIPLEXING)
+static inline bool TLC5940_QueueGS(uint8_t row, channel_t channel, uint16_t value) __attribute__(( always_inline ));
+static inline bool TLC5940_QueueGS(uint8_t row, channel_t channel, uint16_t value) {
+#else // TLC5940_ENABLE_MULTIPLEXING
+static inline bool TLC5940_QueueGS(channel_t channel, uint16_t value) __attribute__(( always_inline ));
+static inline bool TLC5940_QueueGS(channel_t channel, uint16_t value) {
+#endif // TLC5940_ENABLE_MULTIPLEXING
+  uint8_t head = TLC5940_gsQueueHead;
+  if ((uint8_t)(head - TLC5940_gsQueueTail) == TLC5940_GS_QUEUE_SIZE)
+    return false;
+
+  TLC5940_GSCommand_t *p = &TLC5940_gsQueue[head & (TLC5940_GS_QUEUE_SIZE - 1)];
+#if (TLC5940_ENABLE_MULTIPLEXING)
+  p->row = row;
+#endif // TLC5940_ENABLE_MULTIPLEXING
+  p->channel = channel;
+  p->value = value;
+  __asm__ volatile ("" ::: "memory"); // the command must be stored first
+  TLC5940_gsQueueHead = head + 1;
+  return true;
+}
+
+// Applies at most TLC5940_GS_QUEUE_BATCH queued updates to the back
+// buffer, and returns the number applied. Must only be called from the
+// main loop, at the point where it would otherwise be safe to call
+// TLC5940_SetGS(), i.e. right before TLC5940_SetGSUpdateFlag(), once per
+// frame. Each of the TLC5940_DRAW_BUFFERS_N buffers in rotation is brought up
+// to date on its own turn, so an update is only removed from the queue
+// once it has been applied to all of them, and until then it still takes
+// up a slot.
+uint8_t TLC5940_DrainGSQueue(void);
+#endif // TLC5940_ENABLE_GS_QUEUE
+
+#if (TLC5940_INCLUDE_CROSSFADE)
+// Blends the packed frames 'from' and 'to' (each TLC5940_FRAME_BYTES
+// long, in the same format as gsData) straight into the back buffer:
+//   out = from + (to - from) * alpha / 256
+// where alpha = 255 always produces exactly 'to'. Works on three bytes
+// (two channels) at a time, without unpacking through TLC5940_SetGS().
+void TLC5940_Crossfade(const uint8_t *from, const uint8_t *to, uint8_t alpha);
+
+// Incremental version of TLC5940_Crossfade(). Call TLC5940_CrossfadeBegin()
+// once, and then call TLC5940_CrossfadeStep() once per pass through the
+// main loop. Each step blends the next 'channels' channels (rounded up
+// to an even number), and returns true once the whole back buffer has
+// been blended, at which point TLC5940_SetGSUpdateFlag() may be called.
+void TLC5940_CrossfadeBegin(const uint8_t *from, const uint8_t *to, uint8_t alpha);
+bool TLC5940_CrossfadeStep(channel_t channels);
+#endif // TLC5940_INCLUDE_CROSSFADE
+
+#if (TLC5940_INCLUDE_HSV)
+#if (TLC5940_INCLUDE_GAMMA_CORRECT == 0)
+#error "TLC5940_INCLUDE_HSV = 1 requires TLC5940_INCLUDE_GAMMA_CORRECT = 1"
+#endif // TLC5940_INCLUDE_GAMMA_CORRECT
+
+typedef struct {
+  uint16_t hue; // 0 through 65535 covers the whole color wheel
+  uint8_t saturation;
+  uint8_t value;
+} TLC5940_HSV_t;
+
+// Converts a color from HSV to gamma-corrected grayscale values for the
+// red, green and blue components, using only 8x8 hardware multiplies.
+// The hue starts at red (0), passes through green (21845) and blue
+// (43691), and wraps back around to red.
+void TLC5940_HSVtoGS(uint16_t hue, uint8_t saturation, uint8_t value, uint16_t *r, uint16_t *g, uint16_t *b);
+
+#if (TLC5940_ENABLE_MULTIPLEXING && TLC5940_MULTIPLEX_N >= 3)
+// Sets every channel of rows 0, 1 and 2 (red, green and blue) from an
+// array of TLC5940_CHANNELS_N colors, writing two channels per row at a
+// time instead of calling TLC5940_SetGS() three times per channel.
+void TLC5940_SetAllHSV(const TLC5940_HSV_t *hsv);
+#endif // TLC5940_ENABLE_MULTIPLEXING
+#endif // TLC5940_INCLUDE_HSV
+
+#if (TLC5940_INCLUDE_COLOR_MATRIX)
+#if (TLC5940_INCLUDE_GAMMA_CORRECT == 0)
+#error "TLC5940_INCLUDE_COLOR_MATRIX = 1 requires TLC5940_INCLUDE_GAMMA_CORRECT = 1"
+#endif // TLC5940_INCLUDE_GAMMA_CORRECT
+#if (TLC5940_ENABLE_MULTIPLEXING == 0 || TLC5940_MULTIPLEX_N < 3)
+#error "TLC5940_INCLUDE_COLOR_MATRIX = 1 requires multiplexing at least 3 rows"
+#endif // TLC5940_ENABLE_MULTIPLEXING
+
+// Signed fixed-point coefficients with 6 fractional bits, so 64 is 1.0.
+// TLC5940_colorMatrix[out][in] is how much of input color 'in' goes
+// into output row 'out' (0 = red, 1 = green, 2 = blue). The absolute
+// values of each row's coefficients must add up to 127 or less. It
+// starts out as the identity matrix.
+#define TLC5940_COLOR_MATRIX_ONE 64
+extern int8_t TLC5940_colorMatrix[3][3];
+
+// Sets every channel of rows 0, 1 and 2 (red, green and blue) from an
+// array of TLC5940_CHANNELS_N 8-bit R, G, B triples, passing each one
+// through TLC5940_colorMatrix, clamping it to 0 - 255, and then gamma
+// correcting it, in one pass straight into the packed back buffer.
+void TLC5940_SetAllRGB(const uint8_t *rgb);
+#endif // TLC5940_INCLUDE_COLOR_MATRIX
+
+#if (TLC5940_ENABLE_LAYERS)
+#if (TLC5940_LAYERS_N < 1 || TLC5940_LAYERS_N > 8)
+#error "TLC5940_LAYERS_N must be between 1 and 8, inclusive"
+#endif // TLC5940_LAYERS_N
+
+#define TLC5940_BLEND_ADD 0   // saturating add
+#define TLC5940_BLEND_MAX 1   // brightest of the two wins
+#define TLC5940_BLEND_ALPHA 2 // base + (layer - base) * alpha / 256
+
+// Each layer only covers the bytes [start, end) of a packed frame, and
+// its data only needs to hold those (end - start) bytes. Both start and
+// end must fall on the three byte boundaries given by
+// TLC5940_GroupOffset(), since that is how channels are paired up.
+typedef struct {
+  uint8_t *data;
+  gsFrame_t start;
+  gsFrame_t end;
+  uint8_t mode;
+  uint8_t alpha;
+} TLC5940_Layer_t;
+
+#if (TLC5940_ENABLE_MULTIPLEXING)
+#define TLC5940_GroupOffset(row, channel) ((gsFrame_t)((TLC5940_CHANNELS_N - 1 - (channel)) / 2) * 3 + (gsFrame_t)TLC5940_GRAYSCALE_BYTES * (row))
+#else // TLC5940_ENABLE_MULTIPLEXING
+#define TLC5940_GroupOffset(channel) ((gsFrame_t)((TLC5940_CHANNELS_N - 1 - (channel)) / 2) * 3)
+#endif // TLC5940_ENABLE_MULTIPLEXING
+
+extern TLC5940_Layer_t TLC5940_layers[TLC5940_LAYERS_N];
+
+// Sets the packed frame (TLC5940_FRAME_BYTES long) that the layers are
+// composited on top of, and marks the whole frame as dirty
+void TLC5940_SetBaseFrame(const uint8_t *base);
+
+// Changes a layer, marking both its old and new extents as dirty. Pass
+// start == end to remove the layer.
+void TLC5940_SetLayer(uint8_t layer, uint8_t *data, gsFrame_t start, gsFrame_t end, uint8_t mode, uint8_t alpha);
+
+// Sets a single channel within a layer's data, and marks it as dirty.
+// Channels outside of the layer's extent are ignored.
+#if (TLC5940_ENABLE_MULTIPLEXING)
+void TLC5940_SetLayerGS(uint8_t layer, uint8_t row, channel_t channel, uint16_t value);
+#else // TLC5940_ENABLE_MULTIPLEXING
+void TLC5940_SetLayerGS(uint8_t layer, channel_t channel, uint16_t value);
+#endif // TLC5940_ENABLE_MULTIPLEXING
+
+// Marks the bytes [start, end) of the frame as dirty, for when the base
+// frame or a layer's data has been modified directly
+void TLC5940_MarkDirty(gsFrame_t start, gsFrame_t end);
+
+// Recomposites only the dirty parts of the back buffer. Call this right
+// before TLC5940_SetGSUpdateFlag(), once per frame.
+void TLC5940_Compose(void);
+#endif // TLC5940_ENABLE_LAYERS
+
+#if (TLC5940_ENABLE_POV)
+#if (TLC5940_SPI_MODE == 2)
+#error "TLC5940_ENABLE_POV = 1 requires Timer1's input capture unit (ICP1), which TLC5940_SPI_MODE = 2 does not have"
+#endif // TLC5940_SPI_MODE
+#if (TLC5940_ENABLE_FRAME_QUEUE == 0)
+#error "TLC5940_ENABLE_POV = 1 requires TLC5940_ENABLE_FRAME_QUEUE = 1"
+#endif // TLC5940_ENABLE_FRAME_QUEUE
+#if (TLC5940_POV_COLUMNS < 1 || TLC5940_POV_COLUMNS > 255)
+#error "TLC5940_POV_COLUMNS must be between 1 and 255, inclusive"
+#endif // TLC5940_POV_COLUMNS
+#if (TLC5940_POV_HISTORY != 2 && TLC5940_POV_HISTORY != 4 && TLC5940_POV_HISTORY != 8)
+#error "TLC5940_POV_HISTORY must be 2, 4, or 8"
+#endif // TLC5940_POV_HISTORY
+
+// Returns true once enough revolutions have been timed to predict the
+// next one, and for as long as index pulses keep arriving no later than
+// twice the last revolution period
+bool TLC5940_POV_GetSpinning(void);
+
+// Returns the column that should be rendered into the back buffer next,
+// skipping over any columns that can no longer be shown on time. Only
+// call this while TLC5940_POV_GetSpinning() returns true, and
+// TLC5940_GetFrameQueueFull() returns false.
+uint8_t TLC5940_POV_NextColumn(void);
+
+// Queues the back buffer to be shown when the column returned by
+// TLC5940_POV_NextColumn() reaches its angle. When multiplexing, frames
+// can only be promoted at row 0, so the column period should be longer
+// than TLC5940_MULTIPLEX_N interrupt intervals.
+void TLC5940_POV_QueueColumn(void);
+#endif // TLC5940_ENABLE_POV
+
+#if (TLC5940_ENABLE_CALIBRATION)
+#if ((TLC5940_ENABLE_LAYERS || TLC5940_ENABLE_GS_QUEUE) && TLC5940_ENABLE_MASTER_BRIGHTNESS == 0)
+#error "TLC5940_ENABLE_CALIBRATION = 1 scales the back buffer in place, so with TLC5940_ENABLE_LAYERS or TLC5940_ENABLE_GS_QUEUE it requires TLC5940_ENABLE_MASTER_BRIGHTNESS = 1"
+#endif // TLC5940_ENABLE_LAYERS || TLC5940_ENABLE_GS_QUEUE
+
+#if (TLC5940_ENABLE_MULTIPLEXING)
+#define TLC5940_CALIBRATION_ROWS TLC5940_MULTIPLEX_N
+#else // TLC5940_ENABLE_MULTIPLEXING
+#define TLC5940_CALIBRATION_ROWS 1
+#endif // TLC5940_ENABLE_MULTIPLEXING
+
+// The calibration blob stored at TLC5940_CALIBRATION_ADDRESS in EEPROM:
+//   byte 0:      TLC5940_CALIBRATION_VERSION
+//   bytes 1, 2:  number of channels, low byte first
+//   byte 3:      number of rows (TLC5940_MULTIPLEX_N, or 1)
+//   byte 4:      TLC5940_CALIBRATION_HAS_* flags
+//   then, if TLC5940_CALIBRATION_HAS_DC, one DC value (0 - 63) per channel,
+//   then, if TLC5940_CALIBRATION_HAS_GAIN, one gain per channel per row.
+// Channels are stored in order, starting with channel 0 (of row 0). A
+// gain of g scales a channel by (g + 1) / 256, so 255 leaves it alone.
+#define TLC5940_CALIBRATION_VERSION 1
+#define TLC5940_CALIBRATION_HEADER_BYTES 5
+#define TLC5940_CALIBRATION_HAS_DC 0x01
+#define TLC5940_CALIBRATION_HAS_GAIN 0x02
+
+// Gains in the same reversed channel order as gsData, so that they can
+// be applied with a single pass over the back buffer
+extern uint8_t TLC5940_gain[TLC5940_CALIBRATION_ROWS][TLC5940_CHANNELS_N];
+
+// Call once after TLC5940_Init(). Every gain is reset to 255 and then,
+// if a blob of the right version and size is found, its gains are loaded
+// and its DC values are written with TLC5940_SetDC() (when the DC
+// functions are included), so it takes the place of TLC5940_SetAllDC()
+// before TLC5940_ClockInDC(). Returns false if no usable blob was found.
+bool TLC5940_LoadCalibration(void);
+
+// Call right before TLC5940_SetGSUpdateFlag() or TLC5940_QueueFrame(),
+// once the whole back buffer has been drawn (after
+// TLC5940_ApplyMasterBrightness(), and before TLC5940_ApplyPowerBudget(),
+// if those are used). Scales every channel of the buffer shown next
+// (TLC5940_GS_OUT) by its gain, so the Set*GS functions stay as fast as
+// they are without calibration. Since it scales whatever is there, it
+// must not be called twice on the same frame, and unless
+// TLC5940_ENABLE_MASTER_BRIGHTNESS = 1 (which writes that buffer afresh
+// every frame), every channel of the back buffer must be redrawn before
+// each call, or the gains compound with those of the last frame drawn
+// into it.
+void TLC5940_ApplyCalibration(void);
+#endif // TLC5940_ENABLE_CALIBRATION
+
+#if (TLC5940_ENABLE_MASTER_BRIGHTNESS)
+#if (TLC5940_ENABLE_RENDER)
+#error "TLC5940_ENABLE_MASTER_BRIGHTNESS = 1 can't be used with TLC5940_ENABLE_RENDER = 1"
+#endif // TLC5940_ENABLE_RENDER
+#if (TLC5940_ENABLE_TWI_SLAVE)
+#error "TLC5940_ENABLE_MASTER_BRIGHTNESS = 1 can't be used with TLC5940_ENABLE_TWI_SLAVE = 1, which commits frames from its interrupt without TLC5940_ApplyMasterBrightness()"
+#endif // TLC5940_ENABLE_TWI_SLAVE
+
+// A level of 255 leaves the data alone, and any other level scales every
+// channel by level / 256, so 0 turns everything off
+extern uint8_t TLC5940_masterBrightness;
+#if (TLC5940_ENABLE_MULTIPLEXING)
+extern uint8_t TLC5940_rowBrightness[TLC5940_MULTIPLEX_N];
+#endif // TLC5940_ENABLE_MULTIPLEXING
+
+static inline void TLC5940_SetMasterBrightness(uint8_t level) __attribute__(( always_inline ));
+static inline void TLC5940_SetMasterBrightness(uint8_t level) {
+  TLC5940_masterBrightness = level;
+}
+
+#if (TLC5940_ENABLE_MULTIPLEXING)
+// Scales one row on top of the master brightness, for example to even
+// out red, green and blue rows that aren't equally bright
+static inline void TLC5940_SetRowBrightness(uint8_t row, uint8_t level) __attribute__(( always_inline ));
+static inline void TLC5940_SetRowBrightness(uint8_t row, uint8_t level) {
+  TLC5940_rowBrightness[row] = level;
+}
+#endif // TLC5940_ENABLE_MULTIPLEXING
+
+// Call right before TLC5940_SetGSUpdateFlag() or TLC5940_QueueFrame(),
+// once the whole frame has been drawn (and before
+// TLC5940_ApplyCalibration() and TLC5940_ApplyPowerBudget(), if those
+// are used). Writes the unscaled frame that the Set*GS functions draw
+// into (TLC5940_GS_BACK) into the buffer shown next (TLC5940_GS_OUT),
+// three bytes (two channels) at a time, scaled by the brightness. The
+// unscaled frame is left alone, so anything drawn into it stays there at
+// full brightness, and the level can change every frame without the
+// application redrawing anything. Rows at full brightness are only
+// copied. Otherwise it is estimated (not measured) to cost about 80
+// clock cycles per pair of channels, or 640 * TLC5940_N per row: 40 us
+// per TLC5940 (per row) at 16 MHz, so 0.64 ms for 16 of them. "make
+// bench" times it, per TLC5940 and row, for each TLC5940_N from 1 to 16.
+void TLC5940_ApplyMasterBrightness(void);
+#endif // TLC5940_ENABLE_MASTER_BRIGHTNESS
+
+#if (TLC5940_ENABLE_PWM_SWITCHING)
+#if (TLC5940_PWM_BITS == 0)
+#error "TLC5940_ENABLE_PWM_SWITCHING = 1 requires TLC5940_PWM_BITS to be 8, 9, 10, 11, or 12"
+#endif // TLC5940_PWM_BITS
+#if (TLC5940_PWM_BITS_MIN < 8 || TLC5940_PWM_BITS_MIN > TLC5940_PWM_BITS)
+#error "TLC5940_PWM_BITS_MIN must be between 8 and TLC5940_PWM_BITS, inclusive"
+#endif // TLC5940_PWM_BITS_MIN
+#if (TLC5940_INCLUDE_DEFAULT_ISR == 0 || TLC5940_ENABLE_FRAME_QUEUE || TLC5940_ENABLE_RENDER)
+#error "TLC5940_ENABLE_PWM_SWITCHING = 1 requires the default ISR, and can't be used with TLC5940_ENABLE_FRAME_QUEUE or TLC5940_ENABLE_RENDER"
+#endif // TLC5940_INCLUDE_DEFAULT_ISR
+#if (TLC5940_ENABLE_POV || TLC5940_ENABLE_SCHEDULER || TLC5940_ENABLE_SYNC || TLC5940_ENABLE_TRACE)
+#error "TLC5940_ENABLE_PWM_SWITCHING = 1 can't be used with TLC5940_ENABLE_POV, TLC5940_ENABLE_SCHEDULER, TLC5940_ENABLE_SYNC, or TLC5940_ENABLE_TRACE, which all assume a fixed interrupt interval"
+#endif // TLC5940_ENABLE_POV
+#if (TLC5940_ENABLE_POWER_GOVERNOR || TLC5940_HARDWARE_BLANK)
+#error "TLC5940_ENABLE_PWM_SWITCHING = 1 can't be used with TLC5940_ENABLE_POWER_GOVERNOR or TLC5940_HARDWARE_BLANK"
+#endif // TLC5940_ENABLE_POWER_GOVERNOR
+
+// The TLC5940_CTC_TOP that the ISR switches to along with the next frame
+// it latches, or 0 if there is no switch pending
+extern uint8_t TLC5940_pwmTopPending;
+
+// Returns the PWM resolution that the Set*GS functions (and
+// TLC5940_GammaCorrect()) currently work in
+static inline uint8_t TLC5940_GetPWMBits(void) __attribute__(( always_inline ));
+static inline uint8_t TLC5940_GetPWMBits(void) {
+  return TLC5940_pwmBits;
+}
+
+// Switches to 'bits' of PWM resolution (TLC5940_PWM_BITS_MIN to
+// TLC5940_PWM_BITS), with an interrupt every 2^bits clock cycles. Call
+// it right before TLC5940_SetGSUpdateFlag(), once the whole back buffer
+// has been drawn (and after any other Apply* functions). The back buffer
+// is rescaled to the new resolution, and the ISR switches the interrupt
+// interval on the very interrupt that latches it, so no frame is ever
+// shown with the wrong period. Any other buffer (see
+// TLC5940_DRAW_BUFFERS_N) still holds data at the old resolution, and
+// must be redrawn.
+void TLC5940_SetPWMBits(uint8_t bits);
+#endif // TLC5940_ENABLE_PWM_SWITCHING
+
+#if (TLC5940_ENABLE_MATRIX)
+#if (TLC5940_ENABLE_MULTIPLEXING == 0 || TLC5940_INCLUDE_DEFAULT_ISR == 0)
+#error "TLC5940_ENABLE_MATRIX = 1 requires TLC5940_ENABLE_MULTIPLEXING = 1 and TLC5940_INCLUDE_DEFAULT_ISR = 1"
+#endif // TLC5940_ENABLE_MULTIPLEXING
+#if (TLC5940_ENABLE_FRAME_QUEUE)
+#error "TLC5940_ENABLE_MATRIX = 1 can't be used with TLC5940_ENABLE_FRAME_QUEUE = 1"
+#endif // TLC5940_ENABLE_FRAME_QUEUE
+
+// The display is a TLC5940_MATRIX_WIDTH x TLC5940_MATRIX_HEIGHT grid of
+// pixels, where x is the channel and y is the row it is shown on
+#define TLC5940_MATRIX_WIDTH TLC5940_CHANNELS_N
+#define TLC5940_MATRIX_HEIGHT TLC5940_MULTIPLEX_N
+
+// The row of the back buffer that holds each row (y) of the display. The
+// ISR reads the rows of a frame through its own copy of this table, which
+// it takes at the page flip, so scrolling only has to rotate the table.
+extern uint8_t TLC5940_matrixRows[TLC5940_MULTIPLEX_N];
+
+#if (TLC5940_DRAW_BUFFERS_N > 1)
+// The buffer that still has to catch up with TLC5940_Matrix_ScrollLeft()
+// or TLC5940_Matrix_ScrollRight(), or 0 if neither does
+extern uint8_t *TLC5940_matrixPendingBuffer;
+
+// Brings the back buffer up to date with every horizontal scroll made
+// while the other buffer was the back buffer, if it isn't already.
+// TLC5940_Matrix_SetPixel() and the scroll functions call it themselves,
+// so it only has to be called before drawing into the back buffer some
+// other way (such as with TLC5940_SetGS()).
+void TLC5940_Matrix_ApplyScroll(void);
+#endif // TLC5940_DRAW_BUFFERS_N
+
+static inline void TLC5940_Matrix_SetPixel(channel_t x, uint8_t y, uint16_t value) __attribute__(( always_inline ));
+static inline void TLC5940_Matrix_SetPixel(channel_t x, uint8_t y, uint16_t value) {
+#if (TLC5940_DRAW_BUFFERS_N > 1)
+  if (pBack == TLC5940_matrixPendingBuffer)
+    TLC5940_Matrix_ApplyScroll();
+#endif // TLC5940_DRAW_BUFFERS_N
+  TLC5940_SetGS(TLC5940_matrixRows[y], x, value);
+}
+
+// Scrolls the display up by 'rows': row y now shows what row y + rows
+// did, and the rows at the top wrap around to the bottom, where they
+// can be redrawn. Only rotates TLC5940_matrixRows, so it costs
+// O(TLC5940_MULTIPLEX_N) no matter how many pixels there are. Like
+// everything else drawn into the back buffer, it takes effect at the
+// next page flip. Since the other buffer doesn't hold the rows drawn
+// into this one, the last TLC5940_DRAW_BUFFERS_N rows to scroll in have
+// to be redrawn every frame.
+void TLC5940_Matrix_ScrollUp(uint8_t rows);
+void TLC5940_Matrix_ScrollDown(uint8_t rows);
+
+// Scrolls every row of the back buffer left (towards x = 0) or right by
+// 'chips' whole TLC5940s (16 pixels each), with block moves of 24 bytes
+// per TLC5940. The columns scrolled in are cleared. Like the vertical
+// scrolls, it takes effect at the next page flip. The other buffer is
+// shown until then, so it is scrolled at the start of its own turn
+// instead (see TLC5940_Matrix_ApplyScroll()), by every scroll made in
+// the meantime, and only the columns drawn into this buffer have to be
+// redrawn into it.
+void TLC5940_Matrix_ScrollLeft(uint8_t chips);
+void TLC5940_Matrix_ScrollRight(uint8_t chips);
+#endif // TLC5940_ENABLE_MATRIX
+
+#if (TLC5940_ENABLE_TWI_SLAVE)
+#if (TLC5940_SPI_MODE == 2)
+#error "TLC5940_ENABLE_TWI_SLAVE = 1 requires the TWI module, which TLC5940_SPI_MODE = 2 does not have"
+#endif // TLC5940_SPI_MODE
+#if (TLC5940_TWI_ADDRESS < 0x08 || TLC5940_TWI_ADDRESS > 0x77)
+#error "TLC5940_TWI_ADDRESS must be between 0x08 and 0x77, inclusive"
+#endif // TLC5940_TWI_ADDRESS
+#if ((TLC5940_TWI_COMMIT & 1) || TLC5940_TWI_COMMIT == 0x00 || TLC5940_TWI_COMMIT == 0x04 || TLC5940_TWI_COMMIT == 0x06 || TLC5940_TWI_COMMIT > 0xFF)
+#error "TLC5940_TWI_COMMIT must be an even byte other than 0x00, 0x04 or 0x06"
+#endif // TLC5940_TWI_COMMIT
+
+// A write to TLC5940_TWI_ADDRESS starts with the offset into the back
+// buffer (one byte, or two with the high byte first if a frame is more
+// than 255 bytes long), followed by packed grayscale data in the same
+// format as gsData, which is stored straight into the back buffer from
+// that offset on. A whole frame is written from offset 0, and a single
+// row from offset row * TLC5940_GRAYSCALE_BYTES. Bytes past the end of
+// the frame are NACKed.
+//
+// Writing the single byte TLC5940_TWI_COMMIT to the general call address
+// (0x00) commits the back buffer on every slave at once: it calls
+// TLC5940_SetGSUpdateFlag(), or queues the frame to be shown right away
+// with the frame queue. Every other general call is ignored, so other
+// devices on the bus can't commit a half written frame. Until the commit
+// has been taken by the ISR, new writes are NACKed, so the master should
+// retry them.
+#if (TLC5940_ENABLE_MULTIPLEXING)
+#if (24 * TLC5940_N * TLC5940_MULTIPLEX_N > 255)
+#define TLC5940_TWI_OFFSET_BYTES 2
+#else
+#define TLC5940_TWI_OFFSET_BYTES 1
+#endif
+#else // TLC5940_ENABLE_MULTIPLEXING
+#if (24 * TLC5940_N > 255)
+#define TLC5940_TWI_OFFSET_BYTES 2
+#else
+#define TLC5940_TWI_OFFSET_BYTES 1
+#endif
+#endif // TLC5940_ENABLE_MULTIPLEXING
+#endif // TLC5940_ENABLE_TWI_SLAVE
+
+#if (TLC5940_ENABLE_AUDIO)
+#if (TLC5940_SPI_MODE == 2)
+#error "TLC5940_ENABLE_AUDIO = 1 is only supported on the ATmega328P (TLC5940_SPI_MODE = 0 or 1)"
+#endif // TLC5940_SPI_MODE
+#if (TLC5940_AUDIO_FFT_N == 64)
+#define TLC5940_AUDIO_FFT_LOG2N 6
+#elif (TLC5940_AUDIO_FFT_N == 128)
+#define TLC5940_AUDIO_FFT_LOG2N 7
+#else // TLC5940_AUDIO_FFT_N
+#error "TLC5940_AUDIO_FFT_N must be 64 or 128"
+#endif // TLC5940_AUDIO_FFT_N
+#if (TLC5940_AUDIO_ADC_CHANNEL < 0 || TLC5940_AUDIO_ADC_CHANNEL > 7)
+#error "TLC5940_AUDIO_ADC_CHANNEL must be between 0 and 7, inclusive"
+#endif // TLC5940_AUDIO_ADC_CHANNEL
+
+// The spectrum is reduced to this many roughly logarithmic bands, from
+// the lowest bin above DC up to half the sample rate
+#define TLC5940_AUDIO_BANDS_N 8
+
+// The loudest bin of each band, as a 12-bit grayscale value on a log
+// scale (about 256 per doubling of amplitude), which falls off smoothly
+// rather than dropping straight to the next block's level
+extern uint16_t TLC5940_audioLevel[TLC5940_AUDIO_BANDS_N];
+
+// In-place, radix-2 fixed-point FFT of TLC5940_AUDIO_FFT_N points, in
+// natural order in and out. Each stage halves its results, so the
+// output is the DFT divided by TLC5940_AUDIO_FFT_N, and inputs must stay
+// within +/-8192 to leave headroom for the butterflies. Uses nothing but
+// plain C, so it can also be built and checked on a PC.
+void TLC5940_Audio_FFT(int16_t *re, int16_t *im);
+
+// Call from the main loop as often as possible. Whenever the ADC has
+// filled a new block of samples, its DC offset is removed, it is
+// transformed, TLC5940_audioLevel is updated, and true is returned.
+// Otherwise it returns false right away. The CTC interrupt keeps running
+// throughout, so this only ever uses the time between interrupts.
+bool TLC5940_Audio_Process(void);
+
+// Spreads the bands evenly across every channel (of 'row' when
+// multiplexing) with TLC5940_SetGS(), lowest band on channel 0
+#if (TLC5940_ENABLE_MULTIPLEXING)
+void TLC5940_Audio_SetBands(uint8_t row);
+#else // TLC5940_ENABLE_MULTIPLEXING
+void TLC5940_Audio_SetBands(void);
+#endif // TLC5940_ENABLE_MULTIPLEXING
+#endif // TLC5940_ENABLE_AUDIO
+
+#if (TLC5940_ENABLE_SCHEDULER)
+#if (TLC5940_TASKS_N < 1 || TLC5940_TASKS_N > 16)
+#error "TLC5940_TASKS_N must be between 1 and 16, inclusive"
+#endif // TLC5940_TASKS_N
+
+// Times are measured in counts of the CTC timer, which runs at clk_io/64
+#define TLC5940_CYCLES_TO_COUNTS(cycles) ((uint16_t)(((cycles) + 63) / 64))
+#define TLC5940_FPS_TO_COUNTS(fps) ((uint16_t)(F_CPU / 64 / (fps)))
+
+typedef void (*TLC5940_TaskFunc_t)(void);
+
+typedef struct {
+  TLC5940_TaskFunc_t run; // NULL for an empty slot
+  uint16_t budget; // declared worst case run time, in counts
+  uint16_t estimate; // run time that admission is based on
+  uint16_t cost; // run time of the last run, in counts
+  uint32_t total; // run time of every run so far, in counts
+  uint16_t runs;
+  uint16_t deferrals; // frames that it didn't fit into
+  uint16_t overruns; // runs that took longer than the budget
+} TLC5940_Task_t;
+
+// Slot 0 has the highest priority. The statistics may be read (or
+// cleared) by the main loop between calls to TLC5940_RunTasks().
+extern TLC5940_Task_t TLC5940_tasks[TLC5940_TASKS_N];
+
+// Returns the current time in counts, wrapping around every 65536
+// counts. Safe to call with interrupts enabled.
+uint16_t TLC5940_GetTime(void);
+
+// Puts an effect in 'slot' (NULL to empty it), and clears its statistics
+void TLC5940_SetTask(uint8_t slot, TLC5940_TaskFunc_t run, uint16_t budget);
+
+// Runs the tasks in priority order, skipping any whose estimate doesn't
+// fit in the time left before 'deadline' (a time from TLC5940_GetTime(),
+// less than 32768 counts away), and returns how many were deferred to
+// the next frame. A task's estimate is its budget, or if its last run
+// took longer, that run's time. Call once per frame, for example with
+// TLC5940_GetTime() + TLC5940_FPS_TO_COUNTS(60) minus what is needed to
+// finish the frame, and then flip or queue it.
+uint8_t TLC5940_RunTasks(uint16_t deadline);
+#endif // TLC5940_ENABLE_SCHEDULER
+
+#if (TLC5940_ENABLE_SYNC)
+#if (TLC5940_SPI_MODE == 2)
+#error "TLC5940_ENABLE_SYNC = 1 requires INT0, which is USCK when TLC5940_SPI_MODE = 2"
+#endif // TLC5940_SPI_MODE
+#if (TLC5940_INCLUDE_DEFAULT_ISR == 0)
+#error "TLC5940_ENABLE_SYNC = 1 requires TLC5940_INCLUDE_DEFAULT_ISR = 1"
+#endif // TLC5940_INCLUDE_DEFAULT_ISR
+#if (TLC5940_ENABLE_FRAME_QUEUE)
+#error "TLC5940_ENABLE_SYNC = 1 can't be used with TLC5940_ENABLE_FRAME_QUEUE = 1"
+#endif // TLC5940_ENABLE_FRAME_QUEUE
+
+// The sync line joins INT0 (PD2) on every board. The leader drives it,
+// and each follower takes an interrupt on its rising edge.
+#define SYNC_DDR DDRD
+#define SYNC_PORT PORTD
+#define SYNC_PIN PD2
+
+// Nothing changes for the application: TLC5940_SetGSUpdateFlag() still
+// asks for a flip, which then happens on the next frame boundary that the
+// leader announces. The leader announces one whenever its own flag is
+// set, so a follower whose flag isn't set in time skips that one and
+// flips along with a later one.
+#endif // TLC5940_ENABLE_SYNC
+
 #if (TLC5940_ENABLE_MULTIPLEXING)
 #if (TLC5940_USE_GPIOR1)
 #define TLC5940_row GPIOR1
@@ -545,6 +1947,22 @@ extern uint8_t TLC5940_row; // the row we are clocking new data out for
 void TLC5940_Init(void);
 void TLC5940_ClockInGS(void);
 
+#if (TLC5940_INCLUDE_BOOT_FRAME)
+// Use instead of TLC5940_ClockInGS() (and TLC5940_ClockInDC()) to light
+// the outputs with a frame stored in PROGMEM before interrupts are even
+// enabled. 'gs' is TLC5940_FRAME_BYTES long, and 'dc' is
+// TLC5940_DOT_CORRECTION_BYTES long (or NULL to leave DC alone), both
+// packed the same way that the Set*GS and Set*DC functions pack them.
+// The boot frame replaces the zeroes that TLC5940_ClockInGS() would
+// have shifted in, so it is displayed as soon as BLANK goes low, and is
+// left in gsData and the back buffer afterwards.
+#if (TLC5940_INCLUDE_DC_FUNCS)
+void TLC5940_ClockInBootFrame(const uint8_t *gs, const uint8_t *dc);
+#else // TLC5940_INCLUDE_DC_FUNCS
+void TLC5940_ClockInBootFrame(const uint8_t *gs);
+#endif // TLC5940_INCLUDE_DC_FUNCS
+#endif // TLC5940_INCLUDE_BOOT_FRAME
+
 #if (TLC5940_ISR_CTC_TIMER == 0)
 #define TLC5940_TIMER_COMPA_vect TIMER0_COMPA_vect
 #elif (TLC5940_ISR_CTC_TIMER == 2)